@@ -0,0 +1,87 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "AllocationProblem.h"
+
+AllocationProblem::AllocationProblem()
+{
+
+}
+
+// creates the initial state: nothing is allocated, every PM is empty
+AllocationProblem::AllocationProblem(ProblemInstancePtr inst)
+	:instance(inst), VMs(inst->numVMs), PMs(inst->numPMs), free(inst->capacities)
+{
+	for (int i = 0; i < inst->numVMs; i++)
+	{
+		VM& vm = VMs[i];
+		vm.id = i;
+		vm.initialID = inst->initialIDs[i];
+		vm.initialPM = nullptr;
+	}
+
+	for (int i = 0; i < inst->numPMs; i++)
+	{
+		PMs[i].id = i;
+	}
+}
+
+// returns true if the VM fits in the free resources of the PM
+bool AllocationProblem::fits(const VM& vm, const PM& pm) const
+{
+	const ProblemInstance& inst = *instance;
+	for (int d = 0; d < inst.dimension; d++)
+	{
+		if (free[(std::size_t)d * inst.numPMs + pm.id] < inst.demand(vm.id, d))
+			return false;
+	}
+	return true;
+}
+
+// takes the resources of the VM from the PM, the VM must fit
+void AllocationProblem::reserve(const VM& vm, PM& pm)
+{
+	const ProblemInstance& inst = *instance;
+	for (int d = 0; d < inst.dimension; d++)
+	{
+		free[(std::size_t)d * inst.numPMs + pm.id] -= inst.demand(vm.id, d);
+	}
+	pm.numVMs++;
+}
+
+// gives the resources of the VM back to the PM
+void AllocationProblem::release(const VM& vm, PM& pm)
+{
+	const ProblemInstance& inst = *instance;
+	for (int d = 0; d < inst.dimension; d++)
+	{
+		free[(std::size_t)d * inst.numPMs + pm.id] += inst.demand(vm.id, d);
+	}
+	pm.numVMs--;
+}
+
+FreeResources AllocationProblem::freeResources() const
+{
+	FreeResources resources;
+	resources.free = free.empty() ? nullptr : &free[0];
+	resources.numPMs = instance ? instance->numPMs : 0;
+	resources.dimension = instance ? instance->dimension : 0;
+	return resources;
+}
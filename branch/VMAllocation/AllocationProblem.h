@@ -22,13 +22,25 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 
+#include "ProblemInstance.h"
 #include "VM.h"
 #include "PM.h"
 
+// mutable state of one solver on a shared instance
 struct AllocationProblem
 {
+	ProblemInstancePtr instance;
 	std::vector<VM> VMs;
 	std::vector<PM> PMs;
+	std::vector<ResourceValue> free; // free resources of PM i in dimension d: free[d * numPMs + i]
+
+	AllocationProblem();
+	AllocationProblem(ProblemInstancePtr inst);
+
+	bool fits(const VM& vm, const PM& pm) const;
+	void reserve(const VM& vm, PM& pm);
+	void release(const VM& vm, PM& pm);
+	FreeResources freeResources() const;
 };
 
 #endif
\ No newline at end of file
@@ -26,7 +26,10 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 enum AllocatorType
 {
 	BnB,
-	ILP
+	ILP,
+	LNS,
+	DECOMPOSITION,
+	PORTFOLIO
 };
 
 struct AllocatorParams
@@ -35,6 +38,13 @@ struct AllocatorParams
 	std::string name;
 	double timeout; // timeout in seconds
 	int maxMigrationsRatio;
+	bool warmStart; // start from the best allocation found on the instance by the previous allocators
+
+	// cost model
+	double activationCost; // cost of turning on a PM (per unit of capacity in activationCostDimension)
+	double migrationCost; // cost of migrating a VM (per unit of demand in migrationCostDimension)
+	int activationCostDimension; // -1: same cost for every PM
+	int migrationCostDimension; // -1: same cost for every VM
 
 	// force class to be polymorphic
 	virtual void dummy()
@@ -53,6 +63,18 @@ static AllocatorType stringToAllocatorType(const std::string& toConvert)
 	{
 		return ILP;
 	}
+	else if (toConvert == "LNS")
+	{
+		return LNS;
+	}
+	else if (toConvert == "Decomposition")
+	{
+		return DECOMPOSITION;
+	}
+	else if (toConvert == "Portfolio")
+	{
+		return PORTFOLIO;
+	}
 	else
 	{
 		std::cout << "WARNING: Invalid Allocator Type. Defaulting to BnB." << std::endl;
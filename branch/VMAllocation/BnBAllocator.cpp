@@ -24,6 +24,7 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include <cassert>
 #include <iostream>
 #include <climits>
+#include <cfloat>
 
 #include "BnBAllocator.h"
 
@@ -35,7 +36,11 @@ void BnBAllocator::preprocess()
 		// compute number of initial VMs allocated to each PM, and also the number of PMs turned on in the initial assignment (required for bounding)
 		for (auto& vm : m_problem.VMs)
 		{
-			++(vm.initialPM->numAdditionalVMs);
+			if (vm.initialPM != nullptr) // new VMs are not on any PM
+			{
+				++(vm.initialPM->numAdditionalVMs);
+				m_pendingMigrationCosts[vm.initialPM->id] += m_costModel.migrationCost(vm.id);
+			}
 		}
 		m_numAdditionalPMs = std::count_if(m_problem.PMs.cbegin(), m_problem.PMs.cend(), [](const PM& pm) {return pm.numAdditionalVMs > 0; });
 		m_maxNumVMsOnOnePM = std::max_element(m_problem.PMs.cbegin(), m_problem.PMs.cend(),
@@ -69,13 +74,13 @@ void BnBAllocator::preprocess()
 	case NONE:
 		break;
 	case LEXICOGRAPHIC:
-		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), LexicographicVMComparator);
+		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), LexicographicVMComparator(*m_problem.instance));
 		break;
 	case MAXIMUM:
-		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), MaximumVMComparator);
+		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), MaximumVMComparator(*m_problem.instance));
 		break;
 	case SUM:
-		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), SumVMComparator);
+		std::sort(m_problem.VMs.begin(), m_problem.VMs.end(), SumVMComparator(*m_problem.instance));
 		break;
 	default:
 		assert(false); // the enum has to take some value
@@ -87,26 +92,33 @@ void BnBAllocator::preprocess()
 // returns true if the current allocation is valid
 bool BnBAllocator::isAllocationValid()
 {
-	for (int pm = 0; pm < m_numPMs; pm++)
+	const std::vector<ResourceValue>& capacities = m_problem.instance->capacities;
+	for (std::size_t i = 0; i < m_problem.free.size(); i++)
 	{
-		for (int i = 0; i < m_dimension; i++)
-			if (m_problem.PMs[pm].resourcesFree[i] < 0) // constraint violated
-			{
-				return false;
-			}
+		if ((long long)m_problem.free[i] < 0 || m_problem.free[i] > capacities[i]) // constraint violated (an unsigned value wraps around)
+		{
+			return false;
+		}
 	}
 	return true;
 }
 
 // allocates a VM to a PM
-void BnBAllocator::allocate(VM* VMHandled, PM* PMCandidate)
+// returns false if the domain of an unallocated VM became empty (the branch is dead, but the allocation is done and has to be undone)
+bool BnBAllocator::allocate(VM* VMHandled, PM* PMCandidate)
 {
 	assert(m_allocations.find(VMHandled) == m_allocations.end()); // we should only allocate unallocated VMs
 
+	if (mustMigrate(VMHandled))
+		m_numForcedMigrations--;
+
 	//--Turning on a PM--
-	if (!(PMCandidate->isOn()))
+	bool turnedOn = !(PMCandidate->isOn());
+	bool countOnPMs = (m_params.VMSelection == MAX_REGRET);
+	if (turnedOn)
 	{
 		m_numPMsOn++;
+		m_cost += m_costModel.activationCost(PMCandidate->id);
 
 		if (m_params.intelligentBound)
 		{
@@ -121,16 +133,17 @@ void BnBAllocator::allocate(VM* VMHandled, PM* PMCandidate)
 		}
 	}
 
-	// reserve resources
+	// reserve resources, the PM is moved to its new place in the order
 	m_allocations[VMHandled] = PMCandidate;
-	for (int i = 0; i < m_dimension; i++)
-		PMCandidate->resourcesFree[i] -= VMHandled->demand[i];
+	m_PMOfVM[VMHandled->id] = PMCandidate->id;
+	m_problem.reserve(*VMHandled, *PMCandidate);
+	movePM(PMCandidate);
 
 	if (m_params.intelligentBound)
 	{
 		// handling initial PM of the allocated VM
 		// first we check if it is emptiable
-		if (!VMHandled->initialPM->isOn())
+		if (VMHandled->initialPM != nullptr && !VMHandled->initialPM->isOn())
 		{
 			int& numVMs = VMHandled->initialPM->numAdditionalVMs; // saving number of initial VMs remaining on this PM
 
@@ -145,6 +158,7 @@ void BnBAllocator::allocate(VM* VMHandled, PM* PMCandidate)
 
 			// we also have to decrease the counter for the PM
 			--(numVMs);
+			m_pendingMigrationCosts[VMHandled->initialPM->id] -= m_costModel.migrationCost(VMHandled->id);
 		}
 
 		#ifdef VERBOSE_ALG_STEPS
@@ -164,32 +178,72 @@ void BnBAllocator::allocate(VM* VMHandled, PM* PMCandidate)
 	if (VMHandled->initialPM != nullptr && PMCandidate != VMHandled->initialPM)
 	{
 		m_numMigrations++;
+		m_cost += m_costModel.migrationCost(VMHandled->id);
 	}
 
 	Change change;
 	change.VMAllocated = VMHandled;
 	change.targetPM = PMCandidate;
 
-	// updating available PMs lists
-	for (int vmIndex = 0; vmIndex < m_numVMs; vmIndex++)
+	// the domains of the VMs are not stored, only their sizes: a PM is in the domain of a VM if it is allowed, in the cluster of the VM and the VM fits into it
+	bool wipeout = false;
+	m_nextVM = nullptr;
+	if (m_allowedPMs.empty() || m_allowedPMs[PMCandidate->id])
 	{
-		if (m_allocations.find(&m_problem.VMs[vmIndex]) != m_allocations.end()) // VM already allocated, no need to update its available PM list
+		// checking which VMs fitted onto the PM before and still fit now, one linear pass over the demands for each resource
+		std::fill(m_fitsCandidate.begin(), m_fitsCandidate.end(), FITS_BEFORE | FITS_AFTER);
+		for (int i = 0; i < m_dimension; i++)
 		{
-			continue;
+			const ResourceValue* demands = m_problem.instance->demandsOf(i);
+			ResourceValue free = m_problem.free[(std::size_t)i * m_numPMs + PMCandidate->id];
+			ResourceValue freeBefore = free + m_problem.instance->demand(VMHandled->id, i);
+			for (int vm = 0; vm < m_numVMs; vm++)
+				m_fitsCandidate[vm] &= ((demands[vm] <= freeBefore) ? FITS_BEFORE : 0) | ((demands[vm] <= free) ? FITS_AFTER : 0);
 		}
 
-		std::vector<PM*>* availablePMs = &m_problem.VMs[vmIndex].availablePMs;
-		std::vector<PM*>::iterator found = std::find(availablePMs->begin(), availablePMs->end(), PMCandidate);
-
-		if (found != availablePMs->end() && !VMFitsInPM(m_problem.VMs[vmIndex], *PMCandidate)) // if the VM fitted onto the PM but doesn't fit anymore
+		// updating domain sizes (allocated VMs are not maintained), the VM selected next is found in the same pass
+		bool spent = m_numMigrations + m_numForcedMigrations >= m_numMaxMigrations;
+		double bestPrimary = DBL_MAX;
+		double bestSecondary = DBL_MAX;
+		for (int vmIndex = 0; vmIndex < m_numVMs; vmIndex++)
 		{
-			change.doNotFitAnymore.push_back(&m_problem.VMs[vmIndex]);
-			availablePMs->erase(found);
+			VM* vm = &m_problem.VMs[vmIndex];
+			if (m_PMOfVM[vm->id] >= 0)
+				continue;
+			if (!m_problem.instance->inCluster(vm->id, PMCandidate->id)) // the PM is not in its domain
+				m_fitsCandidate[vm->id] = 0;
+			if (m_fitsCandidate[vm->id] == FITS_BEFORE) // the VM fitted onto the PM but doesn't fit anymore
+			{
+				change.doNotFitAnymore.push_back(vm);
+				vm->domainSize--;
+				if (countOnPMs && !turnedOn)
+					m_onDomainSizes[vm->id]--;
+				if (vm->initialPM == PMCandidate) // it can not stay on its initial PM anymore
+					m_numForcedMigrations++;
+				if (vm->domainSize == 0)
+				{
+					wipeout = true;
+					m_wipedOutVM = vm;
+				}
+			}
+			else if (countOnPMs && turnedOn && m_fitsCandidate[vm->id] == (FITS_BEFORE | FITS_AFTER)) // the PM in its domain is on now
+			{
+				change.fitTurnedOnPM.push_back(vm);
+				m_onDomainSizes[vm->id]++;
+			}
+			double primary, secondary;
+			selectionKey(vm, spent, primary, secondary);
+			if (primary < bestPrimary || (primary == bestPrimary && secondary < bestSecondary))
+			{
+				bestPrimary = primary;
+				bestSecondary = secondary;
+				m_nextVM = vm;
+			}
 		}
 	}
 
 	m_changeStack.push(change);
-
+	return !wipeout;
 }
 
 //deallocates a VM
@@ -203,7 +257,7 @@ void BnBAllocator::deAllocate(VM* VMHandled)
 	{
 		// handling initial PM of the allocated VM
 		// first we check if it is emptiable
-		if (!VMHandled->initialPM->isOn())
+		if (VMHandled->initialPM != nullptr && !VMHandled->initialPM->isOn())
 		{
 			int& numVMs = VMHandled->initialPM->numAdditionalVMs;
 
@@ -218,18 +272,21 @@ void BnBAllocator::deAllocate(VM* VMHandled)
 
 			// we also have to increase the counter for the PM
 			++(numVMs);
+			m_pendingMigrationCosts[VMHandled->initialPM->id] += m_costModel.migrationCost(VMHandled->id);
 		}
 	}
 
 	// free resources
 	m_allocations.erase(VMHandled);
-	for (int i = 0; i < m_dimension; i++)
-		PMCandidate->resourcesFree[i] += VMHandled->demand[i];
+	m_PMOfVM[VMHandled->id] = -1;
+	m_problem.release(*VMHandled, *PMCandidate);
+	movePM(PMCandidate);
 
 	//--Turning on a PM--
 	if (!(PMCandidate->isOn()))
 	{
 		m_numPMsOn--;
+		m_cost -= m_costModel.activationCost(PMCandidate->id);
 
 		if (m_params.intelligentBound)
 		{
@@ -262,6 +319,7 @@ void BnBAllocator::deAllocate(VM* VMHandled)
 	if (VMHandled->initialPM != nullptr && PMCandidate != VMHandled->initialPM)
 	{
 		m_numMigrations--;
+		m_cost -= m_costModel.migrationCost(VMHandled->id);
 	}
 
 
@@ -272,32 +330,35 @@ void BnBAllocator::deAllocate(VM* VMHandled)
 
 	for (size_t i = 0; i < change.doNotFitAnymore.size(); i++)
 	{
-		VM* vmFitsAgain = change.doNotFitAnymore[i];
-		std::vector<PM*>::iterator found = std::find(vmFitsAgain->availablePMs.begin(), vmFitsAgain->availablePMs.end(), PMCandidate);
-		if (found == vmFitsAgain->availablePMs.end())
-		{
-			vmFitsAgain->availablePMs.push_back(PMCandidate); // adding the PM to the available PM list
-		}
-		else
-		{
-			assert(false); // PM can't already be in the list, because it was removed
-		}
+		change.doNotFitAnymore[i]->domainSize++; // the PM is in its domain again
+		if (change.doNotFitAnymore[i]->initialPM == PMCandidate)
+			m_numForcedMigrations--;
+		if (m_params.VMSelection == MAX_REGRET && PMCandidate->isOn())
+			m_onDomainSizes[change.doNotFitAnymore[i]->id]++;
 	}
+	for (size_t i = 0; i < change.fitTurnedOnPM.size(); i++)
+		m_onDomainSizes[change.fitTurnedOnPM[i]->id]--; // the PM is off again
+
+	if (mustMigrate(VMHandled))
+		m_numForcedMigrations++;
 
 }
 
 // returns true if all VMs are allocated
 bool BnBAllocator::allVMsAllocated()
 {
-	return m_VMStack.size() == m_numVMs - 1;
+	return m_VMStack.size() == m_numVMs - m_numFixedVMs - 1;
 }
 
 // returns true if two PMs should be considered the same in symmetry breaking
 bool BnBAllocator::PMsAreTheSame(const PM& pm1, const PM& pm2)
 {
+	if (pm1.numVMs != 0 || pm2.numVMs != 0) // only empty PMs are interchangeable
+		return false;
+
 	for (int i = 0; i < m_dimension; i++)
 	{
-		if (!(pm1.capacity[i] == pm2.capacity[i] && pm1.resourcesFree[i] == pm1.capacity[i] && pm2.resourcesFree[i] == pm1.capacity[i]))
+		if (m_problem.instance->capacity(pm1.id, i) != m_problem.instance->capacity(pm2.id, i))
 			return false;
 	}
 
@@ -307,35 +368,104 @@ bool BnBAllocator::PMsAreTheSame(const PM& pm1, const PM& pm2)
 // returns true if the VM fits in the PM
 bool BnBAllocator::VMFitsInPM(const VM& vm, const PM& pm)
 {
-	for (int i = 0; i < m_dimension; i++)
+	return m_problem.fits(vm, pm);
+}
+
+// difference of the cheapest and the second cheapest PM of the VM by the cost the allocation adds
+// the VM can stay on its initial PM, migrate to a PM which is on, or migrate to a PM which is off (the cheapest activation is assumed)
+double BnBAllocator::regret(VM* vm, bool spent)
+{
+	bool canStay = vm->initialPM != nullptr && !mustMigrate(vm);
+	if (vm->domainSize <= 1 || (spent && canStay)) // there is no choice
+		return DBL_MAX;
+
+	bool initialOn = canStay && vm->initialPM->isOn();
+	double migrationCost = (vm->initialPM != nullptr) ? m_costModel.migrationCost(vm->id) : 0;
+	int numOn = m_onDomainSizes[vm->id] - (initialOn ? 1 : 0);
+	int numOff = vm->domainSize - m_onDomainSizes[vm->id] - ((canStay && !initialOn) ? 1 : 0);
+	double costs[3] = { migrationCost, migrationCost + m_minActivationCost, DBL_MAX };
+	int counts[3] = { numOn, numOff, 0 };
+	if (canStay)
+	{
+		costs[2] = initialOn ? 0 : m_costModel.activationCost(vm->initialPM->id);
+		counts[2] = 1;
+	}
+
+	// the two cheapest of the options (an option may count twice)
+	double best = DBL_MAX;
+	double second = DBL_MAX;
+	for (int i = 0; i < 3; i++)
 	{
-		if (pm.resourcesFree[i] < vm.demand[i])
+		for (int k = 0; k < std::min(counts[i], 2); k++)
 		{
-			return false;
+			if (costs[i] < best)
+			{
+				second = best;
+				best = costs[i];
+			}
+			else if (costs[i] < second)
+			{
+				second = costs[i];
+			}
 		}
 	}
+	return second - best;
+}
 
-	return true;
+// key of the unallocated VM in the order of VMSelection (the VM with the smallest primary, then secondary key is selected)
+// when the migrations are spent, the VMs with an initial PM can only stay there
+void BnBAllocator::selectionKey(VM* vm, bool spent, double& primary, double& secondary)
+{
+	int domainSize = (spent && vm->initialPM != nullptr) ? std::min(vm->domainSize, 1) : vm->domainSize;
+	switch (m_params.VMSelection)
+	{
+	case MIN_DOMAIN:
+		primary = domainSize;
+		secondary = 0;
+		break;
+	case DOMAIN_DEMAND:
+		primary = domainSize;
+		secondary = -m_VMDemands[vm->id];
+		break;
+	case MAX_REGRET:
+		primary = -regret(vm, spent);
+		secondary = domainSize;
+		break;
+	case DOM_WDEG:
+		primary = domainSize / m_VMWeights[vm->id];
+		secondary = 0;
+		break;
+	}
 }
 
 // returns the next VM
 VM* BnBAllocator::getNextVM()
 {
-	// find VM candidate with smallest amount of available values
+	// find VM candidate first in the order of VMSelection (known if the last allocation updated the domains)
 	if (m_params.failFirst)
 	{
-		size_t min = INT_MAX;
-		VM* minVM = nullptr;
-		for (size_t i = 0; i < m_problem.VMs.size(); i++)
+		if (m_nextVM != nullptr)
+			return m_nextVM;
+
+		bool spent = m_numMigrations + m_numForcedMigrations >= m_numMaxMigrations;
+		double bestPrimary = DBL_MAX;
+		double bestSecondary = DBL_MAX;
+		VM* bestVM = nullptr;
+		for (auto& vm : m_problem.VMs)
 		{
-			if (m_problem.VMs[i].availablePMs.size() < min && m_allocations.find(&m_problem.VMs[i]) == m_allocations.end()) // return unallocated VM with minimal possible PMs
+			if (m_PMOfVM[vm.id] >= 0)
+				continue;
+			double primary, secondary;
+			selectionKey(&vm, spent, primary, secondary);
+			if (bestVM == nullptr || primary < bestPrimary || (primary == bestPrimary && secondary < bestSecondary))
 			{
-				min = m_problem.VMs[i].availablePMs.size();
-				minVM = &m_problem.VMs[i];
+				bestPrimary = primary;
+				bestSecondary = secondary;
+				bestVM = &vm;
 			}
 		}
 
-		return minVM;
+		return bestVM;
 	}
 	else
 	{
@@ -352,77 +482,373 @@ VM* BnBAllocator::getNextVM()
 	return nullptr;
 }
 
-// initialize PM candidates for every VM
-void BnBAllocator::initializePMCandidates()
+// computes the sort key of a PM from its current free resources
+// PMs which are on are in ascending order (best fit), PMs which are off are in descending order (the biggest one is turned on first),
+// except for MAXIMUM, which orders the PMs which are off ascending as well
+void BnBAllocator::updatePMKey(PM* pm)
+{
+	if (m_PMKeyLength == 0)
+		return;
+
+	long long* key = &m_PMKeys[(std::size_t)pm->id * m_PMKeyLength];
+	long long sign = pm->isOn() ? 1 : -1;
+
+	FreeResources resources = m_problem.freeResources();
+	switch (m_params.PMSortMethod)
+	{
+	case NONE: // only with symmetry breaking, which requires sorted PMs
+	case LEXICOGRAPHIC:
+		for (int i = 0; i < m_dimension; i++)
+			key[i] = sign * resources.get(pm, i);
+		break;
+	case MAXIMUM:
+	{
+		long long maximum = 0;
+		for (int i = 0; i < m_dimension; i++)
+			maximum = std::max(maximum, (long long)resources.get(pm, i));
+		key[0] = maximum;
+		break;
+	}
+	case SUM:
+	{
+		long long sum = 0;
+		for (int i = 0; i < m_dimension; i++)
+			sum += resources.get(pm, i);
+		key[0] = sign * sum;
+		break;
+	}
+	default:
+		assert(false); // the enum has to take some value
+		break;
+	}
+}
+
+// moves a PM to its place in the order of the PMs which are on after its free resources changed (the rest of the order is still sorted)
+// the free resources of a PM which is off are its capacities, so the order of those never changes
+void BnBAllocator::movePM(PM* pm)
 {
-	for (int i = 0; i < m_numVMs; i++)
+	if (m_PMKeyLength == 0)
+		return;
+
+	int position = m_onPositions[pm->id];
+	if (!pm->isOn())
 	{
-		m_problem.VMs[i].PMIterator = m_problem.VMs[i].availablePMs.begin();
+		// turned off: leaves the PMs which are on
+		m_onPMs.erase(m_onPMs.begin() + position);
+		for (int i = position; i < (int)m_onPMs.size(); i++)
+			m_onPositions[m_onPMs[i]->id] = i;
+		m_onPositions[pm->id] = -1;
+		return;
 	}
+
+	updatePMKey(pm);
+	if (position < 0)
+	{
+		// turned on: joins the PMs which are on at the end, then moves to its place
+		position = m_onPMs.size();
+		m_onPMs.push_back(pm);
+	}
+	PMKeyComparator less(&m_PMKeys, m_PMKeyLength);
+	while (position > 0 && less(pm, m_onPMs[position - 1]))
+	{
+		m_onPMs[position] = m_onPMs[position - 1];
+		m_onPositions[m_onPMs[position]->id] = position;
+		position--;
+	}
+	while (position < (int)m_onPMs.size() - 1 && less(m_onPMs[position + 1], pm))
+	{
+		m_onPMs[position] = m_onPMs[position + 1];
+		m_onPositions[m_onPMs[position]->id] = position;
+		position++;
+	}
+	m_onPMs[position] = pm;
+	m_onPositions[pm->id] = position;
+}
+
+// returns true if the VM can not stay on its initial PM in the current state
+bool BnBAllocator::mustMigrate(VM* vm)
+{
+	PM* initialPM = vm->initialPM;
+	return initialPM != nullptr && !((m_allowedPMs.empty() || m_allowedPMs[initialPM->id]) && VMFitsInPM(*vm, *initialPM));
+}
+
+// returns true if the VM may not migrate: the remaining migrations are needed by the VMs which can not stay on their initial PM
+bool BnBAllocator::migrationsSpent(VM* vm)
+{
+	return vm->initialPM != nullptr && m_numMigrations + m_numForcedMigrations >= m_numMaxMigrations && !mustMigrate(vm);
+}
+
+// returns true if the PM is a candidate for the VM in the current state (it is in its domain)
+// identical VMs are only allocated with non-decreasing PM ids along their group
+bool BnBAllocator::isCandidate(VM* vm, PM* pm)
+{
+	if (!m_allowedPMs.empty() && !m_allowedPMs[pm->id])
+		return false;
+	if (!m_problem.instance->inCluster(vm->id, pm->id))
+		return false;
+
+	int previous = m_presolve.groupPrevious(vm->id);
+	if (previous >= 0 && m_PMOfVM[previous] > pm->id)
+		return false;
+	int next = m_presolve.groupNext(vm->id);
+	if (next >= 0 && m_PMOfVM[next] >= 0 && m_PMOfVM[next] < pm->id)
+		return false;
+
+	return VMFitsInPM(*vm, *pm);
+}
+
+// returns true if the PM is tried before the PM order by the VM being allocated
+bool BnBAllocator::isFirstPM(PM* pm)
+{
+	const std::vector<PM*>& firstPMs = m_firstPMs[m_VMStack.size()];
+	return std::find(firstPMs.begin(), firstPMs.end(), pm) != firstPMs.end();
+}
+
+// returns the PM at a position of the PM order: the PMs which are on, then every PM in the order of the PMs which are off
+// with PMScoring: the candidates of the VM being allocated in the order of their scores
+// the negative positions are the PMs tried first (-1 is the last of them)
+PM* BnBAllocator::PMAtIndex(int index)
+{
+	if (index < 0)
+	{
+		const std::vector<PM*>& firstPMs = m_firstPMs[m_VMStack.size()];
+		return firstPMs[firstPMs.size() + index];
+	}
+	if (m_params.PMScoring != UNSCORED)
+		return m_scoredPMs[m_VMStack.size()][index];
+	int numOn = m_onPMs.size();
+	return (index < numOn) ? m_onPMs[index] : m_offPMs[index - numOn];
+}
+
+// returns the number of positions of the PM order
+int BnBAllocator::numIndices()
+{
+	if (m_params.PMScoring != UNSCORED)
+		return m_scoredPMs[m_VMStack.size()].size();
+	return m_onPMs.size() + m_numPMs;
+}
+
+// returns the position of the first candidate of the VM in the PM order from the given position (past the end if there is none)
+// the candidates are filtered lazily: the PMs are only checked when the search gets to them (the scored orders only contain candidates)
+int BnBAllocator::nextCandidateIndex(VM* vm, int index)
+{
+	if (m_params.PMScoring != UNSCORED)
+		return std::min(index, numIndices());
+
+	if (index < 0) // the PMs tried first are all candidates
+		return index;
+	int numOn = m_onPMs.size();
+	if (migrationsSpent(vm)) // only the initial PM is left, it is looked up in the order
+	{
+		PM* initialPM = vm->initialPM;
+		int position = (m_PMKeyLength > 0 && initialPM->isOn()) ? m_onPositions[initialPM->id] : numOn + m_offPositions[initialPM->id];
+		if (position >= index && !isFirstPM(initialPM) && isCandidate(vm, initialPM))
+			return position;
+		return numOn + m_numPMs;
+	}
+	for (; index < numOn + m_numPMs; index++)
+	{
+		PM* pm = PMAtIndex(index);
+		if (index >= numOn && m_PMKeyLength > 0 && pm->isOn()) // it was already among the PMs which are on
+			continue;
+		if (!isFirstPM(pm) && isCandidate(vm, pm))
+			break;
+	}
+	return index;
 }
 
 // returns true if current branch is exhausted in the search tree
 bool BnBAllocator::currentBranchExhausted(VM* VMHandled)
 {
-	return (VMHandled->PMIterator == VMHandled->availablePMs.end());
+	return VMHandled->PMIndex >= numIndices();
 }
 
 // resets PM candidates for a VM
+// the PMs are kept ordered, so the candidates are the PMs of the order which the VM fits into
+// when the search gets back to this VM, every deeper allocation is undone, so the order is the same as now
 void BnBAllocator::resetCandidates(VM* VMHandled)
 {
-	std::vector<PM*>* pms = &(VMHandled->availablePMs);
+	int level = m_VMStack.size();
+	m_conflicts[level].clear();
+	m_chronological[level] = false;
+	m_numTried[level] = 0;
+
+	// incumbent PM first, initial PM first -> they are the first candidates, and they are skipped in the order
+	// (solution-guided search: the search stays close to the best allocation so far)
+	std::vector<PM*>& firstPMs = m_firstPMs[level];
+	firstPMs.clear();
+	bool spent = migrationsSpent(VMHandled); // only the initial PM is a candidate
+	if (m_params.incumbentPMFirst)
+	{
+		auto incumbent = m_bestAllocation.find(VMHandled);
+		if (incumbent != m_bestAllocation.end() && (!spent || incumbent->second == VMHandled->initialPM) && isCandidate(VMHandled, incumbent->second))
+			firstPMs.push_back(incumbent->second);
+	}
+	if (m_params.initialPMFirst && VMHandled->initialPM != nullptr && !isFirstPM(VMHandled->initialPM) && isCandidate(VMHandled, VMHandled->initialPM))
+		firstPMs.push_back(VMHandled->initialPM);
 
-	switch (m_params.PMSortMethod)
+	if (m_params.PMScoring != UNSCORED)
+		scorePMs(VMHandled);
+
+	if (!firstPMs.empty())
+		VMHandled->PMIndex = -(int)firstPMs.size();
+	else
+		VMHandled->PMIndex = nextCandidateIndex(VMHandled, 0);
+}
+
+// orders the candidate PMs of the VM for its level by their scores: the PMs which are on, then the PMs which are off, ties in the order of PMSortMethod
+// the scores of every PM are computed in one pass over the free resources of each dimension
+void BnBAllocator::scorePMs(VM* vm)
+{
+	std::fill(m_PMScores.begin(), m_PMScores.end(), 0.0);
+	switch (m_params.PMScoring)
 	{
-	case NONE:
-		if (m_params.symmetryBreaking) 	// symmetry breaking -> sorted PMs required anyway
-			std::sort(pms->begin(), pms->end(), LexicographicPMComparator);
-		break;
-	case LEXICOGRAPHIC:
-		std::sort(pms->begin(), pms->end(), LexicographicPMComparator);
+	case DOT_PRODUCT: // the largest product has the smallest score
+		for (int i = 0; i < m_dimension; i++)
+		{
+			const ResourceValue* free = &m_problem.free[(std::size_t)i * m_numPMs];
+			double weight = -(double)m_problem.instance->demand(vm->id, i) / (m_maxCapacities[i] * m_maxCapacities[i]);
+			for (int pm = 0; pm < m_numPMs; pm++)
+				m_PMScores[pm] += weight * free[pm];
+		}
 		break;
-	case MAXIMUM:
-		std::sort(pms->begin(), pms->end(), MaximumPMComparator);
+	case L2_RESIDUAL:
+		for (int i = 0; i < m_dimension; i++)
+		{
+			const ResourceValue* free = &m_problem.free[(std::size_t)i * m_numPMs];
+			double demand = m_problem.instance->demand(vm->id, i);
+			double weight = 1 / (m_maxCapacities[i] * m_maxCapacities[i]);
+			for (int pm = 0; pm < m_numPMs; pm++)
+			{
+				double residual = free[pm] - demand;
+				m_PMScores[pm] += weight * residual * residual;
+			}
+		}
 		break;
-	case SUM:
-		std::sort(pms->begin(), pms->end(), SumPMComparator);
+	case DOMINANT_FIT:
+	{
+		int dominant = 0;
+		for (int i = 1; i < m_dimension; i++)
+		{
+			if (m_problem.instance->demand(vm->id, i) / m_maxCapacities[i] > m_problem.instance->demand(vm->id, dominant) / m_maxCapacities[dominant])
+				dominant = i;
+		}
+		const ResourceValue* free = &m_problem.free[(std::size_t)dominant * m_numPMs];
+		double demand = m_problem.instance->demand(vm->id, dominant);
+		for (int pm = 0; pm < m_numPMs; pm++)
+			m_PMScores[pm] = free[pm] - demand;
 		break;
+	}
 	default:
-		assert(false); // the enum has to take some value
+		assert(false); // only called with scoring
 		break;
 	}
 
-	// initial PM first -> bringing it to the start of the list
-	if (m_params.initialPMFirst)
+	// the candidates in the order of PMSortMethod (the PMs which are on are not listed without sort keys), except the ones tried first
+	std::vector<PM*>& order = m_scoredPMs[m_VMStack.size()];
+	order.clear();
+	bool spent = migrationsSpent(vm); // only the initial PM is a candidate
+	for (PM* pm : m_onPMs)
 	{
-		for (size_t i = 0; i < pms->size(); i++)
-		{
-			PM* pm = (*pms)[i];
-			if (pm == VMHandled->initialPM)
-			{
-				pms->erase(pms->begin() + i); // erase
-				pms->insert(pms->begin(), pm); // insert to front
-				break;
-			}
-		}
+		if (!isFirstPM(pm) && (!spent || pm == vm->initialPM) && isCandidate(vm, pm))
+			order.push_back(pm);
+	}
+	for (PM* pm : m_offPMs)
+	{
+		if (m_PMKeyLength == 0 && pm->isOn() && !isFirstPM(pm) && (!spent || pm == vm->initialPM) && isCandidate(vm, pm))
+			order.push_back(pm);
+	}
+	std::size_t numOn = order.size();
+	for (PM* pm : m_offPMs)
+	{
+		if (!pm->isOn() && !isFirstPM(pm) && (!spent || pm == vm->initialPM) && isCandidate(vm, pm))
+			order.push_back(pm);
 	}
 
-	VMHandled->PMIterator = VMHandled->availablePMs.begin();
+	auto lessScore = [this](PM* first, PM* second) { return m_PMScores[first->id] < m_PMScores[second->id]; };
+	std::stable_sort(order.begin(), order.begin() + numOn, lessScore);
+	std::stable_sort(order.begin() + numOn, order.end(), lessScore);
 }
 
 void BnBAllocator::saveVM(VM* VMHandled)
 {
-	m_VMStack.push(VMHandled);
+	m_VMStack.push_back(VMHandled);
 }
 
-// backtracks to previous VM and returns it
-VM* BnBAllocator::backtrackToPreviousVM()
+// adds the levels of the allocations which removed PMs from the domain of the VM:
+// the VMs on the PMs of its cluster which the VM fits onto when they are empty, but not in the current state
+void BnBAllocator::addCulprits(VM* vm, std::vector<int>& conflicts)
+{
+	for (int level = 0; level < (int)m_VMStack.size(); level++)
+	{
+		int pm = m_PMOfVM[m_VMStack[level]->id];
+		if (m_problem.instance->fitsEmpty(vm->id, pm) && m_problem.instance->inCluster(vm->id, pm) && !VMFitsInPM(*vm, m_problem.PMs[pm]))
+			conflicts.push_back(level);
+	}
+}
+
+// adds the levels of the allocations which used up the migration budget: the VMs which migrated, and the VMs on the initial PMs
+// of the unallocated VMs which can not stay there
+void BnBAllocator::addMigrationCulprits(std::vector<int>& conflicts)
+{
+	std::vector<bool> blocked(m_numPMs, false); // initial PM of an unallocated VM which has to migrate
+	for (auto& vm : m_problem.VMs)
+	{
+		if (m_PMOfVM[vm.id] < 0 && mustMigrate(&vm))
+			blocked[vm.initialPM->id] = true;
+	}
+	for (int level = 0; level < (int)m_VMStack.size(); level++)
+	{
+		VM* vm = m_VMStack[level];
+		int pm = m_PMOfVM[vm->id];
+		if (blocked[pm] || (vm->initialPM != nullptr && vm->initialPM->id != pm))
+			conflicts.push_back(level);
+	}
+}
+
+// backtracks from the VM whose candidates are exhausted and returns the VM of the level to continue at (it is still allocated)
+// if every candidate failed because of the capacities or the migration budget, the search jumps back to the latest allocation responsible for them
+// (conflict-directed backjumping), the levels in between are undone, they can not make the exhausted VM fit
+// returns nullptr if no allocation is responsible (there is no allocation of all VMs)
+VM* BnBAllocator::backtrackToPreviousVM(VM* VMHandled)
 {
 	//stack should never be empty
 	assert(!(m_VMStack.empty()));
 
-	VM* top = m_VMStack.top();
-	m_VMStack.pop();
+	int level = m_VMStack.size();
+	int target = level - 1;
+	bool spent = migrationsSpent(VMHandled); // only the initial PM was a candidate, the VM fits onto it
+	int numCandidates = spent ? 1 : VMHandled->domainSize;
+	if (!m_chronological[level] && m_numTried[level] == numCandidates) // the PMs the VM fits onto were all tried
+	{
+		std::vector<int>& conflicts = m_conflicts[level];
+		addCulprits(VMHandled, conflicts);
+		if (spent)
+			addMigrationCulprits(conflicts);
+		if (conflicts.empty())
+			return nullptr;
+		target = *std::max_element(conflicts.begin(), conflicts.end());
+		std::vector<int>& targetConflicts = m_conflicts[target];
+		for (int conflict : conflicts)
+		{
+			if (conflict != target)
+				targetConflicts.push_back(conflict);
+		}
+		std::sort(targetConflicts.begin(), targetConflicts.end());
+		targetConflicts.erase(std::unique(targetConflicts.begin(), targetConflicts.end()), targetConflicts.end());
+	}
+	else
+	{
+		m_chronological[target] = true;
+	}
+
+	while ((int)m_VMStack.size() > target + 1)
+	{
+		deAllocate(m_VMStack.back());
+		m_VMStack.pop_back();
+	}
+	VM* top = m_VMStack.back();
+	m_VMStack.pop_back();
 	return top;
 }
 
@@ -435,7 +861,7 @@ bool BnBAllocator::allPossibilitiesExhausted()
 // returns next PM candidate for VM
 PM* BnBAllocator::getNextPMCandidate(VM* VMHandled)
 {
-	PM* PMCandidate = *(VMHandled->PMIterator);
+	PM* PMCandidate = PMAtIndex(VMHandled->PMIndex);
 	setNextPMCandidate(VMHandled);
 	return PMCandidate;
 }
@@ -443,7 +869,7 @@ PM* BnBAllocator::getNextPMCandidate(VM* VMHandled)
 // sets next PM candidate for VM (automatically called by getter)
 void BnBAllocator::setNextPMCandidate(VM* VMHandled)
 {
-	assert(VMHandled->PMIterator != VMHandled->availablePMs.end()); // there should still be more candidates
+	assert(!currentBranchExhausted(VMHandled)); // there should still be more candidates
 
 	// symmetry breaking, skip same PMs
 	if (m_params.symmetryBreaking)
@@ -452,46 +878,156 @@ void BnBAllocator::setNextPMCandidate(VM* VMHandled)
 		PM* currPM;
 		do
 		{
-			prevPM = *(VMHandled->PMIterator);
+			prevPM = PMAtIndex(VMHandled->PMIndex);
 
-			VMHandled->PMIterator++;
-			if (VMHandled->PMIterator == VMHandled->availablePMs.end())
+			VMHandled->PMIndex = nextCandidateIndex(VMHandled, VMHandled->PMIndex + 1);
+			if (currentBranchExhausted(VMHandled))
 			{
 				break;
 			}
 
-			currPM = *(VMHandled->PMIterator);
+			currPM = PMAtIndex(VMHandled->PMIndex);
 
 		} while (PMsAreTheSame(*prevPM, *currPM) && currPM != VMHandled->initialPM); // if this is the initial assignment, don't skip it
 	}
 
 	else
 	{
-		VMHandled->PMIterator++;
+		VMHandled->PMIndex = nextCandidateIndex(VMHandled, VMHandled->PMIndex + 1);
 	}
 }
 
-double BnBAllocator::computeMinimalExtraCost()
+// uniform costs: only the number of initial VMs matters, the bound is computed from the map of additional VM counts
+template <>
+double BnBAllocator::computeMinimalExtraCost<true>()
 {
-	int remainingMigrations = m_numMaxMigrations - m_numMigrations;
+	return minimalExtraCost(m_additionalVMCounts, m_numAdditionalPMs, m_maxNumVMsOnOnePM, m_numMaxMigrations - m_numMigrations, m_costModel.baseActivationCost(), m_costModel.baseMigrationCost());
+}
+
+// weighted costs: each PM still holding initial VMs is turned on or emptied, whichever is cheaper within the remaining migrations
+template <>
+double BnBAllocator::computeMinimalExtraCost<false>()
+{
+	double extraCost = 0;
+	m_emptyingOptions.clear();
+	for (const auto& pm : m_problem.PMs)
+	{
+		if (pm.isOn() || pm.numAdditionalVMs == 0)
+			continue;
+		extraCost += m_costModel.activationCost(pm.id);
+		double saving = m_costModel.activationCost(pm.id) - m_pendingMigrationCosts[pm.id];
+		if (saving > 0)
+			m_emptyingOptions.push_back({ saving, pm.numAdditionalVMs });
+	}
 
-	int minimalExtraCost = m_numAdditionalPMs * COEFF_NR_OF_ACTIVE_HOSTS;
+	return extraCost - CostModel::maximalSaving(m_emptyingOptions, m_numMaxMigrations - m_numMigrations);
+}
+
+// best cost so far, of any allocator of the race
+double BnBAllocator::bestCost()
+{
+	double bestCost = m_bestCostSoFar;
+	if (m_sharedBound != nullptr) // the best allocation of an other allocator bounds as well
+		bestCost = std::min(bestCost, m_sharedBound->bestCost.load(std::memory_order_relaxed));
+	return bestCost;
+}
+
+// checks the migration limit and the bound of the allocation of the VM to the PM without doing it (the domains are not touched)
+// the bound is the same as after allocate(), the migrations are checked without the VMs which would lose their initial PM
+BnBAllocator::ChildStatus BnBAllocator::peekChild(VM* VMHandled, PM* PMCandidate)
+{
+	bool turnOn = !PMCandidate->isOn();
+	bool migrate = VMHandled->initialPM != nullptr && PMCandidate != VMHandled->initialPM;
+	int numMigrations = m_numMigrations + (migrate ? 1 : 0);
+	if (numMigrations + m_numForcedMigrations - (mustMigrate(VMHandled) ? 1 : 0) > m_numMaxMigrations)
+		return CHILD_TOO_MANY_MIGRATIONS;
+
+	double minimalTotalCost = m_cost;
+	if (turnOn)
+		minimalTotalCost += m_costModel.activationCost(PMCandidate->id);
+	if (migrate)
+		minimalTotalCost += m_costModel.migrationCost(VMHandled->id);
+
+	if (m_params.intelligentBound)
+	{
+		// the data of the bound is changed as allocate() would change it, then restored
+		int numVMsOnCandidate = PMCandidate->numAdditionalVMs;
+		if (turnOn) // the PM can not be emptied
+		{
+			--(m_additionalVMCounts[numVMsOnCandidate]);
+			if (numVMsOnCandidate > 0)
+				--m_numAdditionalPMs;
+			PMCandidate->numAdditionalVMs = 0;
+		}
+		PM* initialPM = (VMHandled->initialPM != nullptr && VMHandled->initialPM != PMCandidate && !VMHandled->initialPM->isOn()) ? VMHandled->initialPM : nullptr;
+		double pendingMigrationCost = 0;
+		if (initialPM != nullptr) // one less initial VM to empty the initial PM of the VM
+		{
+			int& numVMs = initialPM->numAdditionalVMs;
+			--(m_additionalVMCounts[numVMs]);
+			++(m_additionalVMCounts[numVMs - 1]);
+			if (numVMs == 1)
+				--m_numAdditionalPMs;
+			--numVMs;
+			pendingMigrationCost = m_pendingMigrationCosts[initialPM->id];
+			m_pendingMigrationCosts[initialPM->id] -= m_costModel.migrationCost(VMHandled->id);
+		}
+		std::swap(m_numMigrations, numMigrations);
+
+		minimalTotalCost += m_costModel.isUniform() ? computeMinimalExtraCost<true>() : computeMinimalExtraCost<false>();
+
+		std::swap(m_numMigrations, numMigrations);
+		if (initialPM != nullptr)
+		{
+			int& numVMs = initialPM->numAdditionalVMs;
+			++numVMs;
+			if (numVMs == 1)
+				++m_numAdditionalPMs;
+			--(m_additionalVMCounts[numVMs - 1]);
+			++(m_additionalVMCounts[numVMs]);
+			m_pendingMigrationCosts[initialPM->id] = pendingMigrationCost;
+		}
+		if (turnOn)
+		{
+			PMCandidate->numAdditionalVMs = numVMsOnCandidate;
+			if (numVMsOnCandidate > 0)
+				++m_numAdditionalPMs;
+			++(m_additionalVMCounts[numVMsOnCandidate]);
+		}
+	}
+
+	return (minimalTotalCost >= bestCost() * m_params.boundThreshold) ? CHILD_BOUNDED : CHILD_OPEN;
+}
+
+// lower bound for the extra cost of the PMs still holding initial VMs, with uniform costs
+// (emptying the PMs with the least initial VMs while the remaining migrations allow it and it is cheaper than turning them on)
+double BnBAllocator::minimalExtraCost(const std::vector<int>& additionalVMCounts, int numAdditionalPMs, int maxNumVMsOnOnePM, int remainingMigrations, double activationCost, double migrationCost)
+{
+	double minimalExtraCost = numAdditionalPMs * activationCost;
 	int migrationsDone = 0;
 
-	for (int numVMs = 1; numVMs <= m_maxNumVMsOnOnePM; ++numVMs)
+	for (int numVMs = 1; numVMs <= maxNumVMsOnOnePM; ++numVMs)
 	{
-		if (numVMs >= COEFF_NR_OF_ACTIVE_HOSTS / COEFF_NR_OF_MIGRATIONS)
+		if (numVMs * migrationCost >= activationCost)
 			break;
-		int numPMsEmptied = std::min(m_additionalVMCounts[numVMs], (remainingMigrations - migrationsDone) / numVMs);
+		int numPMsEmptied = std::min(additionalVMCounts[numVMs], (remainingMigrations - migrationsDone) / numVMs);
 		migrationsDone += numPMsEmptied * numVMs;
-		minimalExtraCost -= (numPMsEmptied * COEFF_NR_OF_ACTIVE_HOSTS - numPMsEmptied * numVMs * COEFF_NR_OF_MIGRATIONS);
+		minimalExtraCost -= numPMsEmptied * (activationCost - numVMs * migrationCost);
 	}
 
 	return minimalExtraCost;
 }
 
-BnBAllocator::BnBAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams> pa, std::ofstream& l)
-	:m_problem(pr), m_log(l), m_additionalVMCounts(m_problem.VMs.size() + 1, 0)
+// returns true if the parameters ask for the presolve
+static bool presolveEnabled(const std::shared_ptr<AllocatorParams>& pa)
+{
+	std::shared_ptr<BnBParams> params = std::dynamic_pointer_cast<BnBParams>(pa);
+	return params && params->presolve;
+}
+
+BnBAllocator::BnBAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l)
+	:m_presolve(instance, presolveEnabled(pa)), m_problem(m_presolve.instance()), m_costModel(*m_presolve.instance(), *pa), m_log(l),
+	m_additionalVMCounts(m_problem.VMs.size() + 1, 0), m_pendingMigrationCosts(m_problem.PMs.size(), 0), m_PMOfVM(m_problem.VMs.size(), -1), m_fitsCandidate(m_problem.VMs.size(), 1)
 {
 	std::shared_ptr<BnBParams> params = std::dynamic_pointer_cast<BnBParams>(pa);
 
@@ -502,26 +1038,97 @@ BnBAllocator::BnBAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams
 
 	m_numVMs = m_problem.VMs.size();
 	m_numPMs = m_problem.PMs.size();
-	m_dimension = m_problem.VMs[0].demand.size(); // only works if all VMs have the same number of dimensions
+	m_dimension = instance->dimension;
 
-	// computing available migrations
-	m_numMaxMigrations = m_numPMs / m_params.maxMigrationsRatio;
+	// computing available migrations (from the number of PMs before the presolve)
+	m_numMaxMigrations = std::min(m_presolve.numOriginalPMs() / m_params.maxMigrationsRatio, m_presolve.maxUsefulMigrations());
+	if (m_presolve.droppedPMs())
+		m_originalProblem.reset(new AllocationProblem(m_presolve.originalInstance()));
+
+	#ifdef VERBOSE_BASIC
+		if (m_params.presolve)
+		{
+			m_log << "Presolve: " << m_presolve.numOriginalPMs() - m_numPMs << " PMs dropped, " << m_presolve.numGroups() << " groups of identical VMs, ";
+			m_log << m_presolve.maxUsefulMigrations() << " VMs can be migrated" << std::endl;
+		}
+	#endif
 
 	// at the start there are no allocations
 	m_numMigrations = 0;
+	m_numForcedMigrations = 0;
 	m_numPMsOn = 0;
+	m_cost = 0;
 	m_bestCostSoFar = INT_MAX;
 	m_bestSoFarNumMigrations = INT_MAX;
 	m_bestSoFarNumPMsOn = INT_MAX;
-
-	for (int vm = 0; vm < m_numVMs; vm++)
+	m_numNodes = 0;
+	m_numFixedVMs = 0;
+	m_searchCompleted = false;
+	m_sharedBound = nullptr;
+	m_nextVM = nullptr;
+	m_wipedOutVM = nullptr;
+	m_conflicts.resize(m_numVMs + 1);
+	m_chronological.assign(m_numVMs + 1, false);
+	m_numTried.assign(m_numVMs + 1, 0);
+	m_firstPMs.resize(m_numVMs + 1);
+
+	// data of the VM selection and the PM scoring
+	m_maxCapacities.assign(m_dimension, 1);
+	m_VMDemands.assign(m_numVMs, 0);
+	for (int i = 0; i < m_dimension; i++)
 	{
 		for (int pm = 0; pm < m_numPMs; pm++)
+			m_maxCapacities[i] = std::max(m_maxCapacities[i], (double)m_problem.instance->capacity(pm, i));
+		for (int vm = 0; vm < m_numVMs; vm++)
+			m_VMDemands[vm] += m_problem.instance->demand(vm, i) / m_maxCapacities[i];
+	}
+	if (m_params.PMScoring != UNSCORED)
+	{
+		m_scoredPMs.resize(m_numVMs + 1);
+		m_PMScores.resize(m_numPMs);
+	}
+	m_onDomainSizes.assign(m_numVMs, 0);
+	m_minActivationCost = DBL_MAX;
+	for (int pm = 0; pm < m_numPMs; pm++)
+		m_minActivationCost = std::min(m_minActivationCost, m_costModel.activationCost(pm));
+	m_VMWeights.assign(m_numVMs, 1);
+
+	// sort keys of the PMs from their resources (NONE without symmetry breaking: the order of the ids, and no PMs are listed as on)
+	if (m_params.PMSortMethod == NONE && !m_params.symmetryBreaking)
+		m_PMKeyLength = 0;
+	else if (m_params.PMSortMethod == NONE || m_params.PMSortMethod == LEXICOGRAPHIC)
+		m_PMKeyLength = m_dimension;
+	else
+		m_PMKeyLength = 1;
+	m_PMKeys.assign((std::size_t)m_numPMs * m_PMKeyLength, 0);
+	for (auto& pm : m_problem.PMs) // every PM is off yet
+	{
+		updatePMKey(&pm);
+		m_offPMs.push_back(&pm);
+	}
+	std::sort(m_offPMs.begin(), m_offPMs.end(), PMKeyComparator(&m_PMKeys, m_PMKeyLength));
+	m_offPositions.resize(m_numPMs);
+	for (int i = 0; i < m_numPMs; i++)
+		m_offPositions[m_offPMs[i]->id] = i;
+	m_onPositions.assign(m_numPMs, -1);
+
+	// initial domain sizes: every PM is empty, so a VM fits into every PM of a capacity class or none of them (a class is in one cluster)
+	int numPMClasses;
+	std::vector<int> PMClass = m_problem.instance->capacityClasses(numPMClasses);
+	std::vector<int> classSizes(numPMClasses, 0);
+	std::vector<int> classRepresentatives(numPMClasses);
+	for (int pm = 0; pm < m_numPMs; pm++)
+	{
+		classSizes[PMClass[pm]]++;
+		classRepresentatives[PMClass[pm]] = pm;
+	}
+	for (auto& vm : m_problem.VMs)
+	{
+		vm.domainSize = 0;
+		for (int c = 0; c < numPMClasses; c++)
 		{
-			if (VMFitsInPM(m_problem.VMs[vm], m_problem.PMs[pm])) // initialize available PMs list
-			{
-				m_problem.VMs[vm].availablePMs.push_back(&m_problem.PMs[pm]);
-			}
+			if (m_problem.instance->inCluster(vm.id, classRepresentatives[c]) && VMFitsInPM(vm, m_problem.PMs[classRepresentatives[c]]))
+				vm.domainSize += classSizes[c];
 		}
 	}
 
@@ -548,8 +1155,36 @@ void BnBAllocator::solve()
 {
 	m_timer.start();
 
+	if (m_numFixedVMs == m_numVMs) // every VM is fixed, nothing to search
+	{
+		if (m_numMigrations <= m_numMaxMigrations && m_cost < m_bestCostSoFar)
+		{
+			m_bestAllocation = m_allocations;
+			m_bestCostSoFar = m_cost;
+			m_bestSoFarNumPMsOn = m_numPMsOn;
+			m_bestSoFarNumMigrations = m_numMigrations;
+		}
+		return;
+	}
+
+	m_nextVM = nullptr; // the domains may have been changed since the last allocation (restrictPMs())
+	m_numForcedMigrations = 0; // maintained from here by allocate() and deAllocate(), like the PMs which are on in the domains
+	for (auto& vm : m_problem.VMs)
+	{
+		if (m_PMOfVM[vm.id] < 0 && mustMigrate(&vm))
+			m_numForcedMigrations++;
+		if (m_params.VMSelection == MAX_REGRET && m_PMOfVM[vm.id] < 0)
+		{
+			m_onDomainSizes[vm.id] = 0;
+			for (auto& pm : m_problem.PMs)
+			{
+				if (pm.isOn() && (m_allowedPMs.empty() || m_allowedPMs[pm.id]) && m_problem.instance->inCluster(vm.id, pm.id) && VMFitsInPM(vm, pm))
+					m_onDomainSizes[vm.id]++;
+			}
+		}
+	}
 	VM* VMHandled = getNextVM(); // index of current VM
-	initializePMCandidates();
+	resetCandidates(VMHandled);
 
 	#ifdef VERBOSE_ALG_STEPS
 		m_log << std::endl << "Starting search..." << std::endl;
@@ -565,6 +1200,14 @@ void BnBAllocator::solve()
 			break;
 		}
 
+		if (m_sharedBound != nullptr && m_sharedBound->stop.load(std::memory_order_relaxed)) // an other allocator of the race proved optimality
+		{
+			#ifdef VERBOSE_BASIC
+				m_log << "STOPPED." << std::endl;
+			#endif
+			break;
+		}
+
 		if (currentBranchExhausted(VMHandled)) // current branch is exhausted
 		{
 			#ifdef VERBOSE_ALG_STEPS
@@ -575,9 +1218,15 @@ void BnBAllocator::solve()
 			#ifdef VERBOSE_ALG_STEPS
 				m_log << "All possibilities exhausted.";
 			#endif
+				m_searchCompleted = true;
+				break;
+			}
+			VMHandled = backtrackToPreviousVM(VMHandled); // backtrack to previous VM
+			if (VMHandled == nullptr) // the exhausted VM does not fit whatever the allocations are
+			{
+				m_searchCompleted = true;
 				break;
 			}
-			VMHandled = backtrackToPreviousVM(); // backtrack to previous VM
 			#ifdef VERBOSE_ALG_STEPS
 				m_log << "Backtracked to VM " << VMHandled->id << ". ";
 			#endif
@@ -593,7 +1242,24 @@ void BnBAllocator::solve()
 		}
 
 		PM* PMCandidate = getNextPMCandidate(VMHandled);
-		allocate(VMHandled, PMCandidate); // allocate VM
+		m_numNodes++;
+		int level = m_VMStack.size();
+		m_numTried[level]++;
+
+		ChildStatus status = peekChild(VMHandled, PMCandidate); // most children are cut before the allocation
+		if (status != CHILD_OPEN)
+		{
+			if (status == CHILD_BOUNDED)
+				m_chronological[level] = true;
+			else if (!m_chronological[level])
+				addMigrationCulprits(m_conflicts[level]);
+			#ifdef VERBOSE_ALG_STEPS
+				m_log << "VM " << VMHandled->id << " to PM " << PMCandidate->id << ((status == CHILD_BOUNDED) ? ": bound." : ": too many migrations.") << std::endl;
+			#endif
+			continue;
+		}
+
+		bool consistent = allocate(VMHandled, PMCandidate); // allocate VM
 		#ifdef VERBOSE_ALG_STEPS
 			m_log << "Allocated VM " << VMHandled->id << " to PM " << PMCandidate->id << ". ";
 			m_log << "Current allocation: ";
@@ -603,8 +1269,26 @@ void BnBAllocator::solve()
 		#endif
 		assert(isAllocationValid());
 
-		if (m_numMigrations > m_numMaxMigrations) // ran out of migrations
+		if (!consistent) // an unallocated VM has no candidate left
+		{
+			if (!m_chronological[level])
+				addCulprits(m_wipedOutVM, m_conflicts[level]);
+			if (m_params.VMSelection == DOM_WDEG) // the VM and the VM it left without candidates are selected earlier
+			{
+				m_VMWeights[m_wipedOutVM->id]++;
+				m_VMWeights[VMHandled->id]++;
+			}
+			deAllocate(VMHandled);
+			#ifdef VERBOSE_ALG_STEPS
+				m_log << "\tDomain wipeout. Deallocated VM " << VMHandled->id << "." << std::endl;
+			#endif
+			continue;
+		}
+
+		if (m_numMigrations + m_numForcedMigrations > m_numMaxMigrations) // ran out of migrations (counting the ones the unallocated VMs can not avoid)
 		{
+			if (!m_chronological[level])
+				addMigrationCulprits(m_conflicts[level]);
 			deAllocate(VMHandled);
 			#ifdef VERBOSE_ALG_STEPS
 				m_log << "\tToo many migrations. Deallocated VM " << VMHandled->id << "." << std::endl;
@@ -616,7 +1300,7 @@ void BnBAllocator::solve()
 			continue;
 		}
 
-		double cost = COEFF_NR_OF_ACTIVE_HOSTS * m_numPMsOn + COEFF_NR_OF_MIGRATIONS * m_numMigrations;
+		double cost = m_cost; // maintained incrementally by allocate() and deAllocate()
 		#ifdef VERBOSE_ALG_STEPS
 			m_log << "numPMsOn = " << m_numPMsOn << ", numMigrations = " << m_numMigrations <<", cost is: "<< cost << ". " << std::endl;
 		#endif
@@ -625,15 +1309,16 @@ void BnBAllocator::solve()
 
 		if (m_params.intelligentBound)
 		{
-			double extraCost = computeMinimalExtraCost();
+			double extraCost = m_costModel.isUniform() ? computeMinimalExtraCost<true>() : computeMinimalExtraCost<false>();
 			minimalTotalCost += extraCost;
 			#ifdef VERBOSE_ALG_STEPS
 				m_log << "Computed minimal extra cost = " << extraCost << ", minimal total cost = " << minimalTotalCost << std::endl;
 			#endif
 		}
 
-		if (minimalTotalCost >= m_bestCostSoFar * m_params.boundThreshold) // bound
+		if (minimalTotalCost >= bestCost() * m_params.boundThreshold) // bound (the best cost may have been improved by an other allocator since the peek)
 		{
+			m_chronological[level] = true;
 			deAllocate(VMHandled);
 			#ifdef VERBOSE_ALG_STEPS
 				m_log << "\tBound. Deallocated VM " << VMHandled->id << "." << std::endl;
@@ -647,10 +1332,13 @@ void BnBAllocator::solve()
 
 		if (allVMsAllocated()) // all VMs allocated, updating bestSoFar
 		{
+			m_chronological[level] = true;
 			m_bestAllocation = m_allocations;
 			m_bestCostSoFar = cost;
 			m_bestSoFarNumPMsOn = m_numPMsOn;
 			m_bestSoFarNumMigrations = m_numMigrations;
+			if (m_sharedBound != nullptr)
+				m_sharedBound->offer(cost);
 			#ifdef VERBOSE_COST_CHANGE
 				m_log << m_timer.getElapsedTime() << ", " << cost << std::endl;
 			#endif
@@ -690,7 +1378,7 @@ double BnBAllocator::getBestCost()
 			{
 				if (iter.first->id == i)
 				{
-					m_log << iter.first->id << "->" << iter.second->id << " ";
+					m_log << iter.first->id << "->" << m_presolve.originalPM(iter.second->id) << " ";
 					break;
 				}
 			}
@@ -701,11 +1389,48 @@ double BnBAllocator::getBestCost()
 		return (m_bestAllocation.empty()) ? -1 : m_bestCostSoFar;
 }
 
-// computes an initial lower bound for the optimum
-// must be called before the start of the algorithm, but after preprocessing
-double BnBAllocator::computeInitialLowerBound()
+// computes an initial lower bound for the optimum directly from the instance, without building an allocator
+// (same as the bound of the intelligent bounding at the root of the search)
+double BnBAllocator::computeInitialLowerBound(const ProblemInstance& instance, const CostModel& costModel, int numMaxMigrations)
 {
-	return computeMinimalExtraCost();
+	std::vector<int> numInitialVMs(instance.numPMs, 0);
+	std::vector<double> migrationCosts(instance.numPMs, 0); // of the initial VMs of each PM
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		if (instance.initialIDs[vm] >= 0)
+		{
+			++numInitialVMs[instance.initialIDs[vm]];
+			migrationCosts[instance.initialIDs[vm]] += costModel.migrationCost(vm);
+		}
+	}
+
+	if (!costModel.isUniform())
+	{
+		double extraCost = 0;
+		std::vector<CostModel::EmptyingOption> options;
+		for (int pm = 0; pm < instance.numPMs; pm++)
+		{
+			if (numInitialVMs[pm] == 0)
+				continue;
+			extraCost += costModel.activationCost(pm);
+			if (costModel.activationCost(pm) > migrationCosts[pm])
+				options.push_back({ costModel.activationCost(pm) - migrationCosts[pm], numInitialVMs[pm] });
+		}
+		return extraCost - CostModel::maximalSaving(options, numMaxMigrations);
+	}
+
+	std::vector<int> additionalVMCounts(instance.numVMs + 1, 0);
+	int numAdditionalPMs = 0;
+	int maxNumVMsOnOnePM = 0;
+	for (int count : numInitialVMs)
+	{
+		++additionalVMCounts[count];
+		if (count > 0)
+			++numAdditionalPMs;
+		maxNumVMsOnOnePM = std::max(maxNumVMsOnOnePM, count);
+	}
+
+	return minimalExtraCost(additionalVMCounts, numAdditionalPMs, maxNumVMsOnOnePM, numMaxMigrations, costModel.baseActivationCost(), costModel.baseMigrationCost());
 }
 
 // get cost components
@@ -719,7 +1444,181 @@ int BnBAllocator::getMigrations()
 	return m_bestSoFarNumMigrations;
 }
 
+long long BnBAllocator::getNodeCount()
+{
+	return m_numNodes;
+}
+
+// overrides the migration limit given by maxMigrationsRatio (more migrations than the presolve found possible are not allowed)
+// must be called before setIncumbent() and the start of the algorithm
+void BnBAllocator::setMaxMigrations(int maxMigrations)
+{
+	m_numMaxMigrations = std::min(maxMigrations, m_presolve.maxUsefulMigrations());
+}
+
+// fixes VMs to PMs (e.g. the unchanged part of a consolidation), the search only allocates the remaining VMs
+// fixedPMs: for each VM id the index of its PM, or -1 if the VM is free
+// must be called before the start of the algorithm
+void BnBAllocator::fixVMs(const std::vector<int>& fixedPMs)
+{
+	std::vector<int> reducedPMs = m_presolve.reducedPlacement(fixedPMs, m_problem.PMs, true); // the dropped PMs are taken back
+	for (auto& vm : m_problem.VMs)
+	{
+		int pm = reducedPMs[vm.id];
+		if (fixedPMs[vm.id] < 0 || m_allocations.find(&vm) != m_allocations.end())
+			continue;
+
+		if (pm < 0 || !VMFitsInPM(vm, m_problem.PMs[pm]))
+		{
+			m_log << "WARNING: VM " << vm.id << " does not fit onto PM " << fixedPMs[vm.id] << ", it is not fixed." << std::endl;
+			continue;
+		}
+		allocate(&vm, &m_problem.PMs[pm]);
+		m_presolve.removeFromGroup(vm.id);
+		m_numFixedVMs++;
+	}
+}
+
+// the free VMs may only be allocated to the allowed PMs (allowedPMs: for each PM index)
+// must be called before setIncumbent() and the start of the algorithm
+void BnBAllocator::restrictPMs(const std::vector<bool>& allowedPMs)
+{
+	m_allowedPMs = m_presolve.reducedAllowedPMs(allowedPMs, m_problem.PMs);
+	for (auto& vm : m_problem.VMs)
+	{
+		if (m_allocations.find(&vm) != m_allocations.end())
+			continue;
+
+		vm.domainSize = 0;
+		for (const auto& pm : m_problem.PMs)
+		{
+			if (m_allowedPMs[pm.id] && m_problem.instance->inCluster(vm.id, pm.id) && VMFitsInPM(vm, pm))
+				vm.domainSize++;
+		}
+	}
+}
+
+// races with other allocators on the same problem: bounds with the best cost of any of them and stops when one of them is done
+// must be called before the start of the algorithm (after setIncumbent())
+void BnBAllocator::setSharedBound(SharedBound* sharedBound)
+{
+	m_sharedBound = sharedBound;
+	if (!m_bestAllocation.empty())
+		m_sharedBound->offer(m_bestCostSoFar);
+}
+
+// returns true if the search proved that no allocation is better than the best cost (its own or the shared one)
+// this needs an exhaustive search: no timeout, no symmetry breaking and no relaxed bound
+bool BnBAllocator::provedOptimal()
+{
+	return m_searchCompleted && !m_params.symmetryBreaking && m_params.boundThreshold >= 1;
+}
+
+// uses a known allocation (e.g. the result of an ILP solver) as best so far, the search only looks for better ones
+// must be called before the start of the algorithm
+void BnBAllocator::setIncumbent(const AllocationMapType& allocation)
+{
+	std::vector<VM*> VMOfId(m_numVMs, nullptr);
+	for (auto& vm : m_problem.VMs)
+	{
+		VMOfId[vm.id] = &vm;
+	}
+
+	// the PMs are mapped to the reduced instance (a dropped PM is replaced with an equivalent one)
+	// VMs and PMs which are not in the problem are skipped, so the incumbent is not complete
+	auto inProblem = [this](const std::pair<VM* const, PM*>& entry)
+	{
+		return entry.first->id >= 0 && entry.first->id < m_numVMs && entry.second->id >= 0 && entry.second->id < m_presolve.numOriginalPMs();
+	};
+	std::vector<int> placement(m_numVMs, -1);
+	for (const auto& iter : allocation)
+	{
+		if (inProblem(iter))
+			placement[iter.first->id] = iter.second->id;
+	}
+	placement = m_presolve.reducedPlacement(placement, m_problem.PMs, false);
+
+	AllocationMapType incumbent;
+	std::vector<std::vector<int>> load(m_numPMs, std::vector<int>(m_dimension, 0));
+	std::vector<int> numVMsOnPM(m_numPMs, 0);
+	for (const auto& iter : allocation)
+	{
+		if (!inProblem(iter) || placement[iter.first->id] < 0)
+			continue;
+		VM* vm = VMOfId[iter.first->id];
+		PM* pm = &m_problem.PMs[placement[iter.first->id]];
+		incumbent[vm] = pm;
+		for (int i = 0; i < m_dimension; i++)
+			load[pm->id][i] += m_problem.instance->demand(vm->id, i);
+		numVMsOnPM[pm->id]++;
+	}
+
+	// checking that the incumbent is a complete and valid allocation
+	if ((int)incumbent.size() != m_numVMs)
+	{
+		m_log << "WARNING: incumbent is not a complete allocation, it is ignored." << std::endl;
+		return;
+	}
+	int numPMsOn = 0;
+	for (const auto& pm : m_problem.PMs)
+	{
+		for (int i = 0; i < m_dimension; i++)
+		{
+			if (load[pm.id][i] > m_problem.instance->capacity(pm.id, i))
+			{
+				m_log << "WARNING: incumbent violates the capacity of PM " << pm.id << ", it is ignored." << std::endl;
+				return;
+			}
+		}
+		if (numVMsOnPM[pm.id] > 0)
+			numPMsOn++;
+	}
+	int numMigrations = std::count_if(incumbent.cbegin(), incumbent.cend(), [](const std::pair<VM* const, PM*>& iter)
+	{
+		return iter.first->initialPM != nullptr && iter.first->initialPM != iter.second;
+	});
+	if (numMigrations > m_numMaxMigrations)
+	{
+		m_log << "WARNING: incumbent uses too many migrations, it is ignored." << std::endl;
+		return;
+	}
+	for (const auto& iter : incumbent)
+	{
+		if (!m_problem.instance->inCluster(iter.first->id, iter.second->id))
+		{
+			m_log << "WARNING: incumbent moves VM " << iter.first->id << " out of its cluster, it is ignored." << std::endl;
+			return;
+		}
+	}
+
+	double cost = 0;
+	for (const auto& pm : m_problem.PMs)
+	{
+		if (numVMsOnPM[pm.id] > 0)
+			cost += m_costModel.activationCost(pm.id);
+	}
+	for (const auto& iter : incumbent)
+	{
+		if (iter.first->initialPM != nullptr && iter.first->initialPM != iter.second)
+			cost += m_costModel.migrationCost(iter.first->id);
+	}
+	if (cost < m_bestCostSoFar)
+	{
+		m_bestAllocation = incumbent;
+		m_bestCostSoFar = cost;
+		m_bestSoFarNumPMsOn = numPMsOn;
+		m_bestSoFarNumMigrations = numMigrations;
+	}
+}
+
+// the best allocation with the PMs of the original instance
 const AllocationMapType& BnBAllocator::getBestAllocation()
 {
-	return m_bestAllocation;
+	if (!m_presolve.droppedPMs())
+		return m_bestAllocation;
+
+	m_originalBestAllocation.clear();
+	for (const auto& iter : m_bestAllocation)
+		m_originalBestAllocation[&m_originalProblem->VMs[iter.first->id]] = &m_originalProblem->PMs[m_presolve.originalPM(iter.second->id)];
+	return m_originalBestAllocation;
 }
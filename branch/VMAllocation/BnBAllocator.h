@@ -23,7 +23,7 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <memory>
 #include <stack>
-#include <fstream>
+#include <ostream>
 
 #include "VMAllocator.h"
 #include "Change.h"
@@ -31,6 +31,8 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include "BnBParams.h"
 #include "Timer.h"
 #include "PM.h"
+#include "SharedBound.h"
+#include "Presolve.h"
 
 #define VERBOSE_BASIC // logging configuration, input problem and the solution
 
@@ -40,8 +42,13 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 class BnBAllocator : public VMAllocator
 {
-	AllocationProblem m_problem; // the allocation problem
+	enum { FITS_AFTER = 1, FITS_BEFORE = 2 }; // flags of m_fitsCandidate
+	enum ChildStatus { CHILD_OPEN, CHILD_TOO_MANY_MIGRATIONS, CHILD_BOUNDED }; // result of peekChild()
+
+	Presolve m_presolve; // reduction of the instance (the search runs on the reduced instance)
+	AllocationProblem m_problem; // the allocation problem (own state on the shared instance)
 	BnBParams m_params; // algorithm parameters
+	CostModel m_costModel;
 
 	int m_dimension; // dimension of resources
 	int m_numVMs; // number of Virtual Machines
@@ -50,52 +57,108 @@ class BnBAllocator : public VMAllocator
 	int m_numAdditionalPMs; // number of additional PMs required if we now leave all VMs on their initial PM
 	int m_maxNumVMsOnOnePM; // maximal number of "initial VMs" on one PM (initialized once, but not maintained)
 	std::vector<int> m_additionalVMCounts; // maps number of occurences to each "additional VM count"
+	std::vector<double> m_pendingMigrationCosts; // for each PM: migration cost of its additional VMs (maintained together with numAdditionalVMs)
+	std::vector<CostModel::EmptyingOption> m_emptyingOptions; // scratch space of the bound with weighted costs
+	std::vector<long long> m_PMKeys; // sort key of each PM in the current state (m_PMKeyLength values per PM)
+	int m_PMKeyLength;
+	std::vector<PM*> m_onPMs; // PMs which are on, in the order of PMSortMethod (only the PM touched by allocate() or deAllocate() is moved)
+	std::vector<int> m_onPositions; // position of each PM in m_onPMs (-1 if it is off)
+	std::vector<PM*> m_offPMs; // all PMs in the order of PMSortMethod when they are off (never changes, the PMs which are on are skipped)
+	std::vector<int> m_offPositions; // position of each PM in m_offPMs
+	std::vector<bool> m_allowedPMs; // PMs the free VMs may be allocated to (empty if every PM is allowed)
+	VM* m_nextVM; // unallocated VM with the smallest domain, found by the last allocate() (nullptr if it is not known)
+	std::vector<int> m_PMOfVM; // for each VM id: index of its PM in the current allocation (-1 if not allocated)
+	std::vector<double> m_maxCapacities; // for each dimension: the largest capacity of a PM
+	std::vector<std::vector<PM*>> m_firstPMs; // for each level: the candidates of its VM tried before the PM order (the PM in the best allocation, the initial PM)
+	std::vector<std::vector<PM*>> m_scoredPMs; // for each level: the candidate PMs of its VM in the order of PMScoring (the state of a level is restored when the search gets back to it)
+	std::vector<double> m_PMScores; // for each PM: score for the VM being allocated (scratch space of scorePMs())
+	std::vector<double> m_VMDemands; // for each VM id: sum of its demands relative to the largest capacities (DOMAIN_DEMAND)
+	std::vector<int> m_onDomainSizes; // for each VM id: number of PMs in its domain which are on (MAX_REGRET, maintained while the VM is not allocated)
+	double m_minActivationCost; // activation cost of the cheapest PM (MAX_REGRET)
+	std::vector<double> m_VMWeights; // for each VM id: 1 + number of domain wipeouts the VM was involved in (DOM_WDEG)
+	std::vector<unsigned char> m_fitsCandidate; // for each VM id: did/does the VM fit onto the PM just allocated to (FITS_BEFORE, FITS_AFTER, scratch space of allocate())
 
 	AllocationMapType m_allocations; // current allocations
 	AllocationMapType m_bestAllocation; // best allocation so far
+	std::unique_ptr<AllocationProblem> m_originalProblem; // objects of the original instance, only if the presolve dropped PMs
+	AllocationMapType m_originalBestAllocation; // best allocation mapped to the original instance
 	int m_numMaxMigrations;
 	int m_numMigrations;
+	int m_numForcedMigrations; // number of unallocated VMs which can not stay on their initial PM (they have to migrate)
 	int m_numPMsOn;
+	double m_cost; // cost of the current allocation
 	double m_bestCostSoFar; // best cost so far
 	int m_bestSoFarNumMigrations;
 	int m_bestSoFarNumPMsOn;
-
-	std::stack<VM*> m_VMStack; // stack of allocated VMs
+	long long m_numNodes; // number of allocations tried
+	int m_numFixedVMs; // number of VMs allocated before the search (not on the VM stack)
+	bool m_searchCompleted; // the whole search tree was explored (no timeout, no stop)
+	SharedBound* m_sharedBound; // best cost of the allocators racing on the same problem (nullptr if alone)
+
+	std::vector<VM*> m_VMStack; // stack of allocated VMs (the level of a decision is its position)
+	std::vector<std::vector<int>> m_conflicts; // for each level: earlier levels whose allocations made candidates of the level fail (may contain duplicates)
+	std::vector<bool> m_chronological; // for each level: a candidate failed for a reason other than the capacities and the migration budget (bound, a deeper level)
+	std::vector<int> m_numTried; // for each level: number of candidates allocated
+	VM* m_wipedOutVM; // VM whose domain became empty in the last allocate() which returned false
 	std::stack<Change> m_changeStack; // stack of changes during the algorithm
 
-	std::ofstream& m_log; // output log file
+	std::ostream& m_log; // output log
 	Timer m_timer; // timer for creating timestamps
 
 	void preprocess();
 	bool isAllocationValid();
 	double computeCost();
-	void allocate(VM* VMHandled, PM* PMCandidate);
+	bool allocate(VM* VMHandled, PM* PMCandidate);
 	void deAllocate(VM* VMHandled);
 	bool allVMsAllocated();
 	bool PMsAreTheSame(const PM& pm1, const PM& pm2);
 	bool VMFitsInPM(const VM& vm, const PM& pm);
 	VM* getNextVM();
-
-
-	void initializePMCandidates();
+	double regret(VM* vm, bool spent);
+	void selectionKey(VM* vm, bool spent, double& primary, double& secondary);
+
+
+	void updatePMKey(PM* pm);
+	void movePM(PM* pm);
+	bool mustMigrate(VM* vm);
+	bool migrationsSpent(VM* vm);
+	bool isCandidate(VM* vm, PM* pm);
+	bool isFirstPM(PM* pm);
+	PM* PMAtIndex(int index);
+	int numIndices();
+	void scorePMs(VM* vm);
+	int nextCandidateIndex(VM* vm, int index);
 	bool allPossibilitiesExhausted();
 	bool currentBranchExhausted(VM* VMHandled);
 	void resetCandidates(VM* VMHandled);
 	void saveVM(VM* VMHandled);
-	VM* backtrackToPreviousVM();
+	void addCulprits(VM* vm, std::vector<int>& conflicts);
+	void addMigrationCulprits(std::vector<int>& conflicts);
+	VM* backtrackToPreviousVM(VM* VMHandled);
 	PM* getNextPMCandidate(VM* VMHandled);
 	void setNextPMCandidate(VM* VMHandled);
+	template <bool uniformCost>
 	double computeMinimalExtraCost();
+	double bestCost();
+	ChildStatus peekChild(VM* VMHandled, PM* PMCandidate);
+	static double minimalExtraCost(const std::vector<int>& additionalVMCounts, int numAdditionalPMs, int maxNumVMsOnOnePM, int remainingMigrations, double activationCost, double migrationCost);
 
 public:
-	BnBAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams> pa, std::ofstream& l);
+	BnBAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l);
 	void solve() final override;
 	double getBestCost() final override;
 	const AllocationMapType& getBestAllocation() final override;
 	int getActiveHosts() final override;
 	int getMigrations() final override;
-
-	double computeInitialLowerBound();
+	long long getNodeCount() final override;
+	void setIncumbent(const AllocationMapType& allocation) final override;
+	void setMaxMigrations(int maxMigrations);
+	void fixVMs(const std::vector<int>& fixedPMs);
+	void restrictPMs(const std::vector<bool>& allowedPMs);
+	void setSharedBound(SharedBound* sharedBound);
+	bool provedOptimal();
+
+	static double computeInitialLowerBound(const ProblemInstance& instance, const CostModel& costModel, int numMaxMigrations);
 
 };
 
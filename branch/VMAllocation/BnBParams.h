@@ -33,16 +33,38 @@ enum SortType
 	SUM
 };
 
+// VM chosen next by failFirst
+enum VMSelectionType
+{
+	MIN_DOMAIN, // smallest domain
+	DOMAIN_DEMAND, // smallest domain, ties broken by the largest normalized demand
+	MAX_REGRET, // largest difference of the cheapest and the second cheapest PM, ties broken by the smallest domain
+	DOM_WDEG // smallest domain per weight, the weight of a VM grows with the dead ends it is involved in
+};
+
+// order of the candidate PMs by their fit to the VM being allocated (the resources are relative to the largest capacities)
+enum PMScoreType
+{
+	UNSCORED, // the order of PMSortMethod
+	DOT_PRODUCT, // largest dot product of the demands and the free resources first
+	L2_RESIDUAL, // smallest Euclidean norm of the free resources left after the allocation first
+	DOMINANT_FIT // smallest free resource left in the dimension of the largest demand first
+};
+
 struct BnBParams : public AllocatorParams
 {
 	bool failFirst;
+	VMSelectionType VMSelection;
 
 	bool intelligentBound;
 
 	SortType PMSortMethod;
 	SortType VMSortMethod;
+	PMScoreType PMScoring; // the PMs which are on still come first, ties are broken by PMSortMethod
 	bool initialPMFirst;
+	bool incumbentPMFirst; // the PM of the VM in the best allocation so far is tried first (before the initial PM)
 	bool symmetryBreaking; // causes the loss of optimality
+	bool presolve; // dropping interchangeable PMs, grouping identical VMs and tightening the migration budget before the search
 
 	double boundThreshold; // bound also when (cost >= bestSoFar * boundThreshold), makes sense when between 0 and 1
 };
@@ -72,4 +94,54 @@ static SortType stringToSortType(const std::string& toConvert)
 	}
 }
 
+static VMSelectionType stringToVMSelectionType(const std::string& toConvert)
+{
+	if (toConvert == "MIN_DOMAIN")
+	{
+		return MIN_DOMAIN;
+	}
+	else if (toConvert == "DOMAIN_DEMAND")
+	{
+		return DOMAIN_DEMAND;
+	}
+	else if (toConvert == "MAX_REGRET")
+	{
+		return MAX_REGRET;
+	}
+	else if (toConvert == "DOM_WDEG")
+	{
+		return DOM_WDEG;
+	}
+	else
+	{
+		std::cout << "WARNING: Invalid VM Selection Type. Defaulting to MIN_DOMAIN." << std::endl;
+		return MIN_DOMAIN;
+	}
+}
+
+static PMScoreType stringToPMScoreType(const std::string& toConvert)
+{
+	if (toConvert == "UNSCORED")
+	{
+		return UNSCORED;
+	}
+	else if (toConvert == "DOT_PRODUCT")
+	{
+		return DOT_PRODUCT;
+	}
+	else if (toConvert == "L2_RESIDUAL")
+	{
+		return L2_RESIDUAL;
+	}
+	else if (toConvert == "DOMINANT_FIT")
+	{
+		return DOMINANT_FIT;
+	}
+	else
+	{
+		std::cout << "WARNING: Invalid PM Score Type. Defaulting to UNSCORED." << std::endl;
+		return UNSCORED;
+	}
+}
+
 #endif
\ No newline at end of file
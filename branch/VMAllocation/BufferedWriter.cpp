@@ -0,0 +1,135 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include "BufferedWriter.h"
+
+BufferedWriter::BufferedWriter(const std::string& path, std::size_t bufferSize)
+	:m_buffer(bufferSize), m_used(0)
+{
+	m_file = std::fopen(path.c_str(), "wb");
+}
+
+BufferedWriter::~BufferedWriter()
+{
+	close();
+}
+
+bool BufferedWriter::good()
+{
+	return m_file != nullptr;
+}
+
+// makes sure that there is space for at least size more characters in the buffer
+void BufferedWriter::reserve(std::size_t size)
+{
+	if (m_used + size > m_buffer.size())
+	{
+		flush();
+	}
+}
+
+void BufferedWriter::write(const char* data, std::size_t size)
+{
+	if (size > m_buffer.size()) // too big to buffer, write it out directly
+	{
+		flush();
+		if (m_file)
+			std::fwrite(data, 1, size, m_file);
+		return;
+	}
+
+	reserve(size);
+	std::memcpy(&m_buffer[m_used], data, size);
+	m_used += size;
+}
+
+void BufferedWriter::flush()
+{
+	if (m_file && m_used > 0)
+	{
+		std::fwrite(&m_buffer[0], 1, m_used, m_file);
+	}
+	m_used = 0;
+}
+
+void BufferedWriter::close()
+{
+	flush();
+	if (m_file)
+	{
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+BufferedWriter& BufferedWriter::operator<<(const char* str)
+{
+	write(str, std::strlen(str));
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(const std::string& str)
+{
+	write(str.data(), str.size());
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(char c)
+{
+	reserve(1);
+	m_buffer[m_used++] = c;
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(int value)
+{
+	return *this << static_cast<long long>(value);
+}
+
+// integers are formatted by hand, this is considerably faster than the stream or printf machinery
+BufferedWriter& BufferedWriter::operator<<(long long value)
+{
+	char digits[24];
+	int length = 0;
+	unsigned long long absValue = (value < 0) ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+
+	do
+	{
+		digits[length++] = static_cast<char>('0' + absValue % 10);
+		absValue /= 10;
+	} while (absValue > 0);
+
+	reserve(length + 1);
+	if (value < 0)
+		m_buffer[m_used++] = '-';
+	while (length > 0)
+		m_buffer[m_used++] = digits[--length];
+
+	return *this;
+}
+
+BufferedWriter& BufferedWriter::operator<<(double value)
+{
+	char formatted[32];
+	int length = std::snprintf(formatted, sizeof(formatted), "%.10g", value);
+	write(formatted, length);
+	return *this;
+}
@@ -0,0 +1,56 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BUFFEREDWRITER_H
+#define BUFFEREDWRITER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// output file which formats into a large memory buffer and only writes it out in big chunks
+// (used for large generated files, where unbuffered stream operations would dominate the runtime)
+class BufferedWriter
+{
+	std::FILE* m_file;
+	std::vector<char> m_buffer;
+	std::size_t m_used; // number of characters used in the buffer
+
+	void reserve(std::size_t size);
+
+public:
+	BufferedWriter(const std::string& path, std::size_t bufferSize = 1 << 20);
+	~BufferedWriter();
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	bool good();
+	void write(const char* data, std::size_t size);
+	void flush();
+	void close();
+
+	BufferedWriter& operator<<(const char* str);
+	BufferedWriter& operator<<(const std::string& str);
+	BufferedWriter& operator<<(char c);
+	BufferedWriter& operator<<(int value);
+	BufferedWriter& operator<<(long long value);
+	BufferedWriter& operator<<(double value);
+};
+
+#endif
@@ -28,7 +28,8 @@ struct Change
 {
 	VM* VMAllocated;
 	PM* targetPM;
-	std::vector<VM*> doNotFitAnymore; // list of VMs that do not fit onto the target PM anymore
+	std::vector<VM*> doNotFitAnymore; // list of VMs that do not fit onto the target PM anymore (their domain size was decreased)
+	std::vector<VM*> fitTurnedOnPM; // list of VMs that fit onto the target PM which was turned on (only with MAX_REGRET)
 };
 
 #endif
\ No newline at end of file
@@ -2,11 +2,28 @@
 #include <sstream>
 #include <iostream>
 #include "ConfigParser.h"
+#include "CostModel.h"
 
 ConfigParser::ConfigParser(const std::string& path)
 	:m_configFilePath(path)
 {
-
+	seed = -1;
+	numClusters = 0;
+	consolidationSteps = 0;
+	warmStart = false;
+	activationCost = COEFF_NR_OF_ACTIVE_HOSTS;
+	migrationCost = COEFF_NR_OF_MIGRATIONS;
+	activationCostDimension = -1;
+	migrationCostDimension = -1;
+	aggregatedLinking = false;
+	subTimeout = 1;
+	neighbourhoodSize = 4;
+	numThreads = 1;
+	budgetSplit = PROPORTIONAL;
+	presolve = false;
+	VMSelection = MIN_DOMAIN;
+	PMScoring = UNSCORED;
+	incumbentPMFirst = false;
 }
 int ConfigParser::getNumTests()
 {
@@ -39,6 +56,26 @@ bool ConfigParser::getShowDetailedCost()
 	return showDetailedCost;
 }
 
+const std::string& ConfigParser::getInstanceFile()
+{
+	return instanceFile;
+}
+
+const std::string& ConfigParser::getResultFile()
+{
+	return resultFile;
+}
+
+long long ConfigParser::getSeed()
+{
+	return seed;
+}
+
+int ConfigParser::getConsolidationSteps()
+{
+	return consolidationSteps;
+}
+
 void ConfigParser::parse()
 {
 	std::ifstream configFile(m_configFilePath);
@@ -67,10 +104,15 @@ void ConfigParser::parse()
 			, PMmax
 			, numPMtypes
 		);
+	m_generator->setNumClusters(numClusters);
 }
 
 bool ConfigParser::getKeyValue(const std::string& line, std::string& key, std::string& value)
 {
+	if (!line.empty() && line[0] == '#') // comment
+	{
+		return false;
+	}
 	std::istringstream lineStream(line);
 	if (!std::getline(lineStream, key, '='))
 	{
@@ -93,6 +135,18 @@ void ConfigParser::processGeneralParameter(const std::string& key, const std::st
 	{
 		numTests = std::stoi(value);
 	}
+	else if (key == "instanceFile")
+	{
+		instanceFile = value;
+	}
+	else if (key == "resultFile")
+	{
+		resultFile = value;
+	}
+	else if (key == "seed")
+	{
+		seed = std::stoll(value);
+	}
 	else if (key == "dimensions")
 	{
 		dimensions = std::stoi(value);
@@ -141,6 +195,14 @@ void ConfigParser::processGeneralParameter(const std::string& key, const std::st
 	{
 		numPMtypes = std::stoi(value);
 	}
+	else if (key == "numClusters")
+	{
+		numClusters = std::stoi(value);
+	}
+	else if (key == "consolidationSteps")
+	{
+		consolidationSteps = std::stoi(value);
+	}
 	else
 	{
 		std::cout << "Invalid key in config file: "<< key << std::endl;
@@ -174,11 +236,28 @@ void ConfigParser::processAllocator(std::ifstream& configFile)
 	{
 		tempParams = std::make_shared<ILPParams>();
 	}
+	else if (allocatorType == LNS)
+	{
+		tempParams = std::make_shared<LNSParams>();
+	}
+	else if (allocatorType == DECOMPOSITION)
+	{
+		tempParams = std::make_shared<DecompositionParams>();
+	}
+	else if (allocatorType == PORTFOLIO)
+	{
+		tempParams = std::make_shared<PortfolioParams>();
+	}
 	
 	tempParams->allocatorType = allocatorType;
 	tempParams->name = name;
 	tempParams->timeout = timeout;
 	tempParams->maxMigrationsRatio = maxMigrationsRatio;
+	tempParams->warmStart = warmStart;
+	tempParams->activationCost = activationCost;
+	tempParams->migrationCost = migrationCost;
+	tempParams->activationCostDimension = activationCostDimension;
+	tempParams->migrationCostDimension = migrationCostDimension;
 
 
 	std::shared_ptr<BnBParams> bnbParams = std::dynamic_pointer_cast<BnBParams>(tempParams);
@@ -187,11 +266,15 @@ void ConfigParser::processAllocator(std::ifstream& configFile)
 	{
 		bnbParams->boundThreshold = boundThreshold;
 		bnbParams->failFirst = failFirst;
+		bnbParams->VMSelection = VMSelection;
 		bnbParams->intelligentBound = intelligentBound;
 		bnbParams->VMSortMethod = VMSortMethod;
 		bnbParams->PMSortMethod = PMSortMethod;
+		bnbParams->PMScoring = PMScoring;
 		bnbParams->symmetryBreaking = symmetryBreaking;
 		bnbParams->initialPMFirst = initialPMFirst;
+		bnbParams->incumbentPMFirst = incumbentPMFirst;
+		bnbParams->presolve = presolve;
 	}
 
 	std::shared_ptr<ILPParams> ilpParams = std::dynamic_pointer_cast<ILPParams>(tempParams);
@@ -199,6 +282,47 @@ void ConfigParser::processAllocator(std::ifstream& configFile)
 	if (ilpParams)
 	{
 		ilpParams->solverType = solverType;
+		ilpParams->aggregatedLinking = aggregatedLinking;
+	}
+
+	std::shared_ptr<LNSParams> lnsParams = std::dynamic_pointer_cast<LNSParams>(tempParams);
+
+	if (lnsParams)
+	{
+		lnsParams->subTimeout = subTimeout;
+		lnsParams->neighbourhoodSize = neighbourhoodSize;
+		lnsParams->numThreads = numThreads;
+	}
+
+	std::shared_ptr<DecompositionParams> decompositionParams = std::dynamic_pointer_cast<DecompositionParams>(tempParams);
+
+	if (decompositionParams)
+	{
+		decompositionParams->numThreads = numThreads;
+		decompositionParams->budgetSplit = budgetSplit;
+	}
+
+	std::shared_ptr<PortfolioParams> portfolioParams = std::dynamic_pointer_cast<PortfolioParams>(tempParams);
+
+	if (portfolioParams)
+	{
+		std::istringstream names(portfolio);
+		std::string memberName;
+		while (std::getline(names, memberName, ','))
+		{
+			std::shared_ptr<BnBParams> member = findBnBParams(memberName);
+			if (!member)
+			{
+				std::cout << "Invalid portfolio member in config file (not a BnB configuration defined before): " << memberName << std::endl;
+				exit(1);
+			}
+			portfolioParams->members.push_back(member);
+		}
+		if (portfolioParams->members.empty())
+		{
+			std::cout << "Empty portfolio in config file: " << name << std::endl;
+			exit(1);
+		}
 	}
 
 	m_paramsList.push_back(tempParams);
@@ -218,10 +342,34 @@ void ConfigParser::processAllocatorParameter(const std::string& key, const std::
 	{
 		timeout = std::stoi(value);
 	}
+	else if (key == "warmStart")
+	{
+		warmStart = stringToBool(value);
+	}
+	else if (key == "activationCost")
+	{
+		activationCost = std::stod(value);
+	}
+	else if (key == "migrationCost")
+	{
+		migrationCost = std::stod(value);
+	}
+	else if (key == "activationCostDimension")
+	{
+		activationCostDimension = std::stoi(value);
+	}
+	else if (key == "migrationCostDimension")
+	{
+		migrationCostDimension = std::stoi(value);
+	}
 	else if (key == "solverType")
 	{
 		solverType = stringToSolverType(value);
 	}
+	else if (key == "aggregatedLinking")
+	{
+		aggregatedLinking = stringToBool(value);
+	}
 	else if (key == "boundThreshold")
 	{
 		boundThreshold = std::stod(value);
@@ -234,6 +382,10 @@ void ConfigParser::processAllocatorParameter(const std::string& key, const std::
 	{
 		failFirst = stringToBool(value);
 	}
+	else if (key == "VMSelection")
+	{
+		VMSelection = stringToVMSelectionType(value);
+	}
 	else if (key == "intelligentBound")
 	{
 		intelligentBound = stringToBool(value);
@@ -246,6 +398,10 @@ void ConfigParser::processAllocatorParameter(const std::string& key, const std::
 	{
 		PMSortMethod = stringToSortType(value);
 	}
+	else if (key == "PMScoring")
+	{
+		PMScoring = stringToPMScoreType(value);
+	}
 	else if (key == "symmetryBreaking")
 	{
 		symmetryBreaking = stringToBool(value);
@@ -254,6 +410,45 @@ void ConfigParser::processAllocatorParameter(const std::string& key, const std::
 	{
 		initialPMFirst = stringToBool(value);
 	}
+	else if (key == "incumbentPMFirst")
+	{
+		incumbentPMFirst = stringToBool(value);
+	}
+	else if (key == "presolve")
+	{
+		presolve = stringToBool(value);
+	}
+	else if (key == "subTimeout")
+	{
+		subTimeout = std::stod(value);
+	}
+	else if (key == "neighbourhoodSize")
+	{
+		neighbourhoodSize = std::stoi(value);
+	}
+	else if (key == "numThreads")
+	{
+		numThreads = std::stoi(value);
+	}
+	else if (key == "budgetSplit")
+	{
+		budgetSplit = stringToBudgetSplitType(value);
+	}
+	else if (key == "portfolio")
+	{
+		portfolio = value;
+	}
+}
+
+// returns the parameters of the BnB configuration with the given name (nullptr if there is none)
+std::shared_ptr<BnBParams> ConfigParser::findBnBParams(const std::string& name)
+{
+	for (const auto& params : m_paramsList)
+	{
+		if (params->name == name && params->allocatorType == BnB)
+			return std::dynamic_pointer_cast<BnBParams>(params);
+	}
+	return nullptr;
 }
 
 bool ConfigParser::stringToBool(const std::string& toConvert)
@@ -27,6 +27,9 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include "AllocatorParams.h"
 #include "ILPParams.h"
 #include "BnBParams.h"
+#include "LNSParams.h"
+#include "DecompositionParams.h"
+#include "PortfolioParams.h"
 
 using ParamsPtrVectorType = std::vector<std::shared_ptr<AllocatorParams>>;
 
@@ -44,6 +47,9 @@ private:
 
 	bool showDetailedCost;
 	int numTests;
+	std::string instanceFile; // binary instance file to solve instead of generated instances (empty if not used)
+	std::string resultFile; // binary result store, results are appended (empty: new file in the logs folder)
+	long long seed; // seed of the first generated instance, instance i uses seed+i (-1: seeded from the clock)
 
 	// generator parameters
 	int dimensions;
@@ -54,24 +60,49 @@ private:
 	int PMmin;
 	int PMmax;
 	int numPMtypes;
+	int numClusters;
+	int consolidationSteps; // consolidation runs after each instance, starting from its best allocation
 
 	// common allocator parameters
 	AllocatorType allocatorType;
 	std::string name;
 	double timeout;
+	bool warmStart;
+	double activationCost;
+	double migrationCost;
+	int activationCostDimension;
+	int migrationCostDimension;
 
 	// ILP only
 	SolverType solverType;
+	bool aggregatedLinking;
 
 	// BnB only
 	double boundThreshold;
 	int maxMigrationsRatio;
 	bool failFirst;
+	VMSelectionType VMSelection;
 	bool intelligentBound;
 	SortType VMSortMethod;
 	SortType PMSortMethod;
+	PMScoreType PMScoring;
 	bool symmetryBreaking;
 	bool initialPMFirst;
+	bool incumbentPMFirst;
+	bool presolve;
+
+	// LNS and decomposition
+	int numThreads;
+
+	// LNS only
+	double subTimeout;
+	int neighbourhoodSize;
+
+	// decomposition only
+	BudgetSplitType budgetSplit;
+
+	// portfolio only
+	std::string portfolio; // names of the BnB configurations, separated by commas
 
 	// helpers
 	std::unique_ptr<ProblemGenerator> m_generator;
@@ -81,6 +112,7 @@ private:
 	void processAllocator(std::ifstream& configFile);
 	void processGeneralParameter(const std::string& key, const std::string& value);
 	void processAllocatorParameter(const std::string& key, const std::string& value);
+	std::shared_ptr<BnBParams> findBnBParams(const std::string& name);
 	bool stringToBool(const std::string& toConvert);
 public:
 	ConfigParser(const std::string& path);
@@ -91,6 +123,10 @@ public:
 	Steps getVMs();
 	Steps getPMs();
 	bool getShowDetailedCost();
+	const std::string& getInstanceFile();
+	const std::string& getResultFile();
+	long long getSeed();
+	int getConsolidationSteps();
 };
 
 #endif
\ No newline at end of file
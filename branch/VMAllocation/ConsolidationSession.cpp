@@ -0,0 +1,429 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ConsolidationSession.h"
+#include "BnBAllocator.h"
+#include "CostModel.h"
+
+ConsolidationSession::ConsolidationSession(std::shared_ptr<AllocatorParams> params, std::ostream& log)
+	:m_params(params), m_log(log), m_numFreePMs(2), m_maxMigrations(-1), m_activeHosts(0), m_migrations(0)
+{
+
+}
+
+void ConsolidationSession::setNumFreePMs(int numFreePMs)
+{
+	m_numFreePMs = numFreePMs;
+}
+
+void ConsolidationSession::setMaxMigrations(int maxMigrations)
+{
+	m_maxMigrations = maxMigrations;
+}
+
+void ConsolidationSession::reset(ProblemInstancePtr instance, const std::vector<int>& placement)
+{
+	m_instance = instance;
+	m_placement = placement;
+	m_VMIds.resize(instance->numVMs);
+	m_PMIds.resize(instance->numPMs);
+	for (int i = 0; i < instance->numVMs; i++)
+		m_VMIds[i] = i;
+	for (int i = 0; i < instance->numPMs; i++)
+		m_PMIds[i] = i;
+
+	std::vector<bool> on(instance->numPMs, false);
+	for (int pm : placement)
+	{
+		if (pm >= 0)
+			on[pm] = true;
+	}
+	m_activeHosts = std::count(on.begin(), on.end(), true);
+	m_migrations = 0;
+}
+
+// starting incumbent: unaffected VMs stay on their initial PM, the affected ones are allocated first fit
+// (initial PM first, then PMs already on, then the others), VMs which do not fit anywhere are left unallocated (-1)
+// the affected VMs with an initial PM are placed before the others, so they keep their PM whenever it still fits them
+std::vector<int> ConsolidationSession::repairPlacement(const ProblemInstance& instance, const std::vector<bool>& affected)
+{
+	std::vector<int> placement(instance.numVMs, -1);
+	std::vector<long long> free(instance.capacities.begin(), instance.capacities.end());
+	std::vector<bool> on(instance.numPMs, false);
+
+	auto fits = [&](int vm, int pm)
+	{
+		for (int d = 0; d < instance.dimension; d++)
+		{
+			if (free[(std::size_t)d * instance.numPMs + pm] < instance.demand(vm, d))
+				return false;
+		}
+		return true;
+	};
+	auto place = [&](int vm, int pm)
+	{
+		for (int d = 0; d < instance.dimension; d++)
+			free[(std::size_t)d * instance.numPMs + pm] -= instance.demand(vm, d);
+		placement[vm] = pm;
+		on[pm] = true;
+	};
+
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		if (!affected[vm])
+			place(vm, instance.initialIDs[vm]);
+	}
+
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		int initial = instance.initialIDs[vm];
+		if (affected[vm] && initial >= 0 && fits(vm, initial))
+			place(vm, initial);
+	}
+
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		for (int pass = 0; pass < 2 && placement[vm] < 0; pass++) // first pass: PMs already on
+		{
+			for (int pm = 0; pm < instance.numPMs; pm++)
+			{
+				if (on[pm] == (pass == 0) && instance.inCluster(vm, pm) && fits(vm, pm))
+				{
+					place(vm, pm);
+					break;
+				}
+			}
+		}
+	}
+
+	return placement;
+}
+
+double ConsolidationSession::apply(const ConsolidationDelta& delta)
+{
+	const ProblemInstance& old = *m_instance;
+	int dimension = old.dimension;
+
+	std::unordered_set<int> removedVMs(delta.removedVMs.begin(), delta.removedVMs.end());
+	std::unordered_set<int> removedPMs(delta.removedPMs.begin(), delta.removedPMs.end());
+	std::unordered_map<int, const std::vector<int>*> resizedVMs;
+	for (const auto& vm : delta.resizedVMs)
+		resizedVMs[vm.id] = &vm.values;
+
+	// building the new PM list: remaining PMs, then the added ones
+	std::vector<int> newPMIndex(old.numPMs, -1);
+	std::vector<int> oldPMIndex; // -1 for added PMs
+	std::vector<int> PMIds;
+	for (int pm = 0; pm < old.numPMs; pm++)
+	{
+		if (removedPMs.count(m_PMIds[pm]))
+			continue;
+		newPMIndex[pm] = PMIds.size();
+		oldPMIndex.push_back(pm);
+		PMIds.push_back(m_PMIds[pm]);
+	}
+	for (const auto& pm : delta.addedPMs)
+	{
+		oldPMIndex.push_back(-1);
+		PMIds.push_back(pm.id);
+	}
+	std::vector<bool> touchedPM(PMIds.size(), false); // a VM left the PM or was resized on it
+
+	// building the new VM list: remaining VMs, then the added ones
+	std::vector<int> oldVMIndex; // -1 for added VMs
+	std::vector<int> VMIds;
+	std::vector<bool> affected; // the VM has to be (re)allocated
+	std::vector<bool> forced; // the VM has to leave its PM in any case (the PM was removed, or the VM does not fit on it after a resize)
+	for (int vm = 0; vm < old.numVMs; vm++)
+	{
+		int pm = (m_placement[vm] >= 0) ? newPMIndex[m_placement[vm]] : -1;
+		if (removedVMs.count(m_VMIds[vm]))
+		{
+			if (pm >= 0)
+				touchedPM[pm] = true;
+			continue;
+		}
+		bool resized = resizedVMs.count(m_VMIds[vm]) > 0;
+		if (resized && pm >= 0)
+			touchedPM[pm] = true;
+		oldVMIndex.push_back(vm);
+		VMIds.push_back(m_VMIds[vm]);
+		affected.push_back(resized || pm < 0);
+		forced.push_back(m_placement[vm] >= 0 && pm < 0);
+	}
+	for (const auto& vm : delta.addedVMs)
+	{
+		oldVMIndex.push_back(-1);
+		VMIds.push_back(vm.id);
+		affected.push_back(true);
+		forced.push_back(false);
+	}
+
+	int numVMs = VMIds.size();
+	int numPMs = PMIds.size();
+	auto instance = std::make_shared<ProblemInstance>(dimension, numVMs, numPMs);
+	bool valid = true;
+	for (int vm = 0; vm < numVMs; vm++)
+	{
+		int oldVM = oldVMIndex[vm];
+		const std::vector<int>* demand = nullptr;
+		if (oldVM < 0)
+			demand = &delta.addedVMs[vm - (numVMs - delta.addedVMs.size())].values;
+		else if (resizedVMs.count(VMIds[vm]))
+			demand = resizedVMs[VMIds[vm]];
+
+		for (int d = 0; d < dimension; d++)
+			valid &= instance->setDemand(vm, d, demand ? (*demand)[d] : old.demand(oldVM, d));
+		instance->initialIDs[vm] = (oldVM < 0 || m_placement[oldVM] < 0) ? -1 : newPMIndex[m_placement[oldVM]];
+	}
+	for (int pm = 0; pm < numPMs; pm++)
+	{
+		int oldPM = oldPMIndex[pm];
+		const std::vector<int>* capacity = (oldPM < 0) ? &delta.addedPMs[pm - (numPMs - delta.addedPMs.size())].values : nullptr;
+		for (int d = 0; d < dimension; d++)
+			valid &= instance->setCapacity(pm, d, capacity ? (*capacity)[d] : old.capacity(oldPM, d));
+		if (!old.PMClusters.empty())
+			instance->PMClusters.push_back((oldPM < 0) ? delta.addedPMs[pm - (numPMs - delta.addedPMs.size())].cluster : old.PMClusters[oldPM]);
+	}
+	if (!valid)
+	{
+		m_log << "WARNING: consolidation delta contains resource values which cannot be stored, it is ignored." << std::endl;
+		return -1;
+	}
+
+	// a resized VM which does not fit on its PM any more (next to the VMs staying there) has to leave it
+	std::vector<long long> free(instance->capacities.begin(), instance->capacities.end());
+	for (int pass = 0; pass < 2; pass++) // first pass: unaffected VMs, they stay
+	{
+		for (int vm = 0; vm < numVMs; vm++)
+		{
+			int initial = instance->initialIDs[vm];
+			if (initial < 0 || affected[vm] != (pass == 1))
+				continue;
+			bool fits = true;
+			for (int d = 0; d < dimension; d++)
+				fits &= free[(std::size_t)d * numPMs + initial] >= instance->demand(vm, d);
+			if (!fits)
+			{
+				forced[vm] = true;
+				instance->initialIDs[vm] = -1;
+				continue;
+			}
+			for (int d = 0; d < dimension; d++)
+				free[(std::size_t)d * numPMs + initial] -= instance->demand(vm, d);
+		}
+	}
+
+	// choosing the subproblem
+	// re-allocated VMs: the affected ones, and the ones on touched or least loaded PMs (free PMs)
+	// their candidate PMs: the free PMs, the PMs with the most free resources, the added PMs and the biggest empty PMs
+	std::vector<int> numVMsOnPM(numPMs, 0);
+	std::vector<long long> freeResources(numPMs, 0); // sum of the free resources if the VMs stay
+	for (int pm = 0; pm < numPMs; pm++)
+	{
+		for (int d = 0; d < dimension; d++)
+			freeResources[pm] += instance->capacity(pm, d);
+	}
+	for (int vm = 0; vm < numVMs; vm++)
+	{
+		int initial = instance->initialIDs[vm];
+		if (initial < 0)
+			continue;
+		numVMsOnPM[initial]++;
+		for (int d = 0; d < dimension; d++)
+			freeResources[initial] -= instance->demand(vm, d);
+	}
+	std::vector<bool> freePM(touchedPM);
+	std::vector<bool> allowedPM(numPMs, true);
+	if (m_numFreePMs >= 0)
+	{
+		std::vector<int> onPMs;
+		for (int pm = 0; pm < numPMs; pm++)
+		{
+			if (numVMsOnPM[pm] > 0 && !freePM[pm])
+				onPMs.push_back(pm);
+		}
+		int count = std::min<int>(m_numFreePMs, onPMs.size());
+		std::partial_sort(onPMs.begin(), onPMs.begin() + count, onPMs.end(), [&](int pm1, int pm2)
+		{
+			return numVMsOnPM[pm1] < numVMsOnPM[pm2];
+		});
+		for (int i = 0; i < count; i++)
+			freePM[onPMs[i]] = true;
+
+		onPMs.erase(onPMs.begin(), onPMs.begin() + count);
+		count = std::min<int>(m_numFreePMs, onPMs.size());
+		std::partial_sort(onPMs.begin(), onPMs.begin() + count, onPMs.end(), [&](int pm1, int pm2)
+		{
+			return freeResources[pm1] > freeResources[pm2];
+		});
+		for (int pm = 0; pm < numPMs; pm++)
+			allowedPM[pm] = freePM[pm] || oldPMIndex[pm] < 0;
+		for (int i = 0; i < count; i++)
+			allowedPM[onPMs[i]] = true;
+
+		std::vector<int> emptyPMs;
+		for (int pm = 0; pm < numPMs; pm++)
+		{
+			if (numVMsOnPM[pm] == 0 && !allowedPM[pm])
+				emptyPMs.push_back(pm);
+		}
+		count = std::min<int>(m_numFreePMs + delta.removedPMs.size(), emptyPMs.size());
+		std::partial_sort(emptyPMs.begin(), emptyPMs.begin() + count, emptyPMs.end(), [&](int pm1, int pm2)
+		{
+			return freeResources[pm1] > freeResources[pm2];
+		});
+		for (int i = 0; i < count; i++)
+			allowedPM[emptyPMs[i]] = true;
+	}
+	else
+	{
+		freePM.assign(numPMs, true);
+	}
+	std::vector<int> fixedPMs(numVMs, -1);
+	for (int vm = 0; vm < numVMs; vm++)
+	{
+		int initial = instance->initialIDs[vm];
+		if (!affected[vm] && initial >= 0 && !freePM[initial])
+			fixedPMs[vm] = initial;
+	}
+
+	std::shared_ptr<BnBParams> params = std::dynamic_pointer_cast<BnBParams>(m_params);
+	if (!params)
+	{
+		m_log << "WARNING: consolidation needs BnB parameters." << std::endl;
+		return -1;
+	}
+	// the forced VMs have no initial PM in the new instance, so the allocator does not count their moves:
+	// they use up a part of the migration limit, and their migration cost is added to the cost of the allocation
+	CostModel costModel(*instance, *params);
+	int numForced = 0;
+	double forcedCost = 0;
+	for (int vm = 0; vm < numVMs; vm++)
+	{
+		if (forced[vm])
+		{
+			numForced++;
+			forcedCost += costModel.migrationCost(vm);
+		}
+	}
+	int maxMigrations = (m_maxMigrations >= 0 ? m_maxMigrations : numPMs / params->maxMigrationsRatio) - numForced;
+	if (maxMigrations < 0)
+	{
+		m_log << "WARNING: the forced moves exceed the migration limit by " << -maxMigrations << ", no other VM is migrated." << std::endl;
+		maxMigrations = 0;
+	}
+
+	BnBAllocator allocator(instance, params, m_log);
+	allocator.setMaxMigrations(maxMigrations);
+	allocator.fixVMs(fixedPMs);
+	allocator.restrictPMs(allowedPM);
+
+	// the repaired placement only moves forced, new and resized VMs, so it is within the limit if every VM could be placed
+	std::vector<int> incumbent = repairPlacement(*instance, affected);
+	bool repaired = std::find(incumbent.begin(), incumbent.end(), -1) == incumbent.end();
+	if (repaired)
+	{
+		AllocationProblem incumbentState(instance);
+		AllocationMapType incumbentMap;
+		for (int vm = 0; vm < numVMs; vm++)
+			incumbentMap[&incumbentState.VMs[vm]] = &incumbentState.PMs[incumbent[vm]];
+		allocator.setIncumbent(incumbentMap);
+	}
+	allocator.solve();
+
+	// the delta has happened in any case, so the new state always becomes the starting point of the next run
+	// without a result of the allocator the repaired placement is kept, VMs which fit nowhere stay unallocated until a later delta
+	double cost = allocator.getBestCost();
+	std::vector<int> placement(numVMs, -1);
+	if (cost >= 0)
+	{
+		for (const auto& iter : allocator.getBestAllocation())
+			placement[iter.first->id] = iter.second->id;
+		cost += forcedCost;
+		m_activeHosts = allocator.getActiveHosts();
+		m_migrations = allocator.getMigrations() + numForced;
+	}
+	else
+	{
+		placement = incumbent;
+		std::vector<bool> on(numPMs, false);
+		m_migrations = numForced;
+		for (int vm = 0; vm < numVMs; vm++)
+		{
+			if (placement[vm] < 0)
+				continue;
+			on[placement[vm]] = true;
+			if (instance->initialIDs[vm] >= 0 && instance->initialIDs[vm] != placement[vm])
+				m_migrations++;
+		}
+		m_activeHosts = std::count(on.begin(), on.end(), true);
+		if (repaired)
+		{
+			cost = costModel.cost(*instance, placement) + forcedCost;
+		}
+		else
+		{
+			m_log << "WARNING: some VMs fit on no PM after the consolidation delta, they stay unallocated." << std::endl;
+		}
+	}
+	m_instance = instance;
+	m_placement = placement;
+	m_VMIds = VMIds;
+	m_PMIds = PMIds;
+	return cost;
+}
+
+ProblemInstancePtr ConsolidationSession::getInstance()
+{
+	return m_instance;
+}
+
+const std::vector<int>& ConsolidationSession::getVMIds()
+{
+	return m_VMIds;
+}
+
+const std::vector<int>& ConsolidationSession::getPMIds()
+{
+	return m_PMIds;
+}
+
+int ConsolidationSession::getPMOf(int VMId)
+{
+	auto found = std::find(m_VMIds.begin(), m_VMIds.end(), VMId);
+	if (found == m_VMIds.end() || m_placement[found - m_VMIds.begin()] < 0)
+		return -1;
+	return m_PMIds[m_placement[found - m_VMIds.begin()]];
+}
+
+int ConsolidationSession::getActiveHosts()
+{
+	return m_activeHosts;
+}
+
+int ConsolidationSession::getMigrations()
+{
+	return m_migrations;
+}
@@ -0,0 +1,92 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CONSOLIDATIONSESSION_H
+#define CONSOLIDATIONSESSION_H
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "ProblemInstance.h"
+#include "AllocatorParams.h"
+
+// changes between two consolidation runs, VMs and PMs are referred to by their external ids
+struct ConsolidationDelta
+{
+	struct Resources
+	{
+		int id;
+		std::vector<int> values; // demand of a VM or capacity of a PM, one value per dimension
+		int cluster = 0; // cluster of an added PM (ignored if the PMs are not clustered)
+	};
+
+	std::vector<Resources> addedVMs; // new VMs, they are not on any PM yet
+	std::vector<int> removedVMs; // departed VMs
+	std::vector<Resources> resizedVMs; // VMs with a new demand
+	std::vector<Resources> addedPMs; // new (empty) PMs
+	std::vector<int> removedPMs; // PMs going into maintenance, their VMs have to be moved
+};
+
+// keeps the solved state of a data center between consolidation runs and re-optimizes it after each delta
+// only the VMs touched by the delta and the VMs on the least loaded PMs are re-allocated by a BnBAllocator,
+// every other VM is fixed to its current PM, and the previous allocation (repaired greedily) is the starting incumbent
+class ConsolidationSession
+{
+	std::shared_ptr<AllocatorParams> m_params; // parameters of the BnBAllocator
+	std::ostream& m_log;
+
+	ProblemInstancePtr m_instance; // current instance, the initial PMs are the ones of the previous run
+	std::vector<int> m_placement; // for each VM index: index of its PM in the current state
+	std::vector<int> m_VMIds; // external id of each VM index
+	std::vector<int> m_PMIds; // external id of each PM index
+
+	int m_numFreePMs; // number of least loaded PMs whose VMs are re-allocated as well (-1: every VM is re-allocated)
+	int m_maxMigrations; // migration limit of one run (-1: given by maxMigrationsRatio)
+
+	int m_activeHosts;
+	int m_migrations;
+
+	std::vector<int> repairPlacement(const ProblemInstance& instance, const std::vector<bool>& affected);
+
+public:
+	ConsolidationSession(std::shared_ptr<AllocatorParams> params, std::ostream& log);
+
+	void setNumFreePMs(int numFreePMs);
+	void setMaxMigrations(int maxMigrations);
+
+	// starts from a solved state: placement contains the PM index of each VM, the ids are the indices
+	void reset(ProblemInstancePtr instance, const std::vector<int>& placement);
+
+	// applies the delta and re-optimizes, returns the cost of the new state (migrations are counted from the previous state)
+	// VMs which have to leave their PM (removed PM, or no room after a resize) are moved even beyond the migration limit
+	// the PMs keep their clusters, the VMs which have to leave their PM are placed like new VMs (in any cluster)
+	// returns -1 if some VMs fit on no PM: they stay unallocated in the new state
+	double apply(const ConsolidationDelta& delta);
+
+	ProblemInstancePtr getInstance();
+	const std::vector<int>& getVMIds(); // external id of each VM of the current instance
+	const std::vector<int>& getPMIds(); // external id of each PM of the current instance
+	int getPMOf(int VMId); // external id of the PM of the VM, -1 for unknown VMs
+	int getActiveHosts();
+	int getMigrations();
+};
+
+#endif
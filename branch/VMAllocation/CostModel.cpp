@@ -0,0 +1,90 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include "CostModel.h"
+
+CostModel::CostModel(const ProblemInstance& instance, const AllocatorParams& params)
+	:m_activationCosts(instance.numPMs, params.activationCost), m_migrationCosts(instance.numVMs, params.migrationCost),
+	m_baseActivationCost(params.activationCost), m_baseMigrationCost(params.migrationCost)
+{
+	int activationDimension = (params.activationCostDimension < instance.dimension) ? params.activationCostDimension : -1;
+	int migrationDimension = (params.migrationCostDimension < instance.dimension) ? params.migrationCostDimension : -1;
+	m_uniform = activationDimension < 0 && migrationDimension < 0;
+
+	// the costs are given per unit of the resource in the chosen dimension
+	if (activationDimension >= 0)
+	{
+		for (int pm = 0; pm < instance.numPMs; pm++)
+			m_activationCosts[pm] *= instance.capacity(pm, activationDimension);
+	}
+	if (migrationDimension >= 0)
+	{
+		for (int vm = 0; vm < instance.numVMs; vm++)
+			m_migrationCosts[vm] *= instance.demand(vm, migrationDimension);
+	}
+}
+
+// cost of a complete allocation (placement: the PM of each VM)
+double CostModel::cost(const ProblemInstance& instance, const std::vector<int>& placement) const
+{
+	std::vector<bool> on(instance.numPMs, false);
+	double cost = 0;
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		if (!on[placement[vm]])
+		{
+			on[placement[vm]] = true;
+			cost += m_activationCosts[placement[vm]];
+		}
+		if (instance.initialIDs[vm] >= 0 && instance.initialIDs[vm] != placement[vm])
+			cost += m_migrationCosts[vm];
+	}
+	return cost;
+}
+
+// upper bound for the saving of emptying PMs with the remaining migrations (fractional knapsack)
+// the options are reordered
+double CostModel::maximalSaving(std::vector<EmptyingOption>& options, int remainingMigrations)
+{
+	std::sort(options.begin(), options.end(), [](const EmptyingOption& o1, const EmptyingOption& o2)
+	{
+		return o1.saving * o2.numMigrations > o2.saving * o1.numMigrations; // saving per migration, descending
+	});
+
+	double saving = 0;
+	for (const auto& option : options)
+	{
+		if (remainingMigrations <= 0 || option.saving <= 0)
+			break;
+		if (option.numMigrations <= remainingMigrations)
+		{
+			saving += option.saving;
+			remainingMigrations -= option.numMigrations;
+		}
+		else
+		{
+			saving += option.saving * remainingMigrations / option.numMigrations;
+			remainingMigrations = 0;
+		}
+	}
+	return saving;
+}
@@ -0,0 +1,83 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <vector>
+
+#include "ProblemInstance.h"
+#include "AllocatorParams.h"
+
+// default cost coefficients
+#define COEFF_NR_OF_ACTIVE_HOSTS 10
+#define COEFF_NR_OF_MIGRATIONS 1
+
+// cost of an allocation: the activation cost of each PM turned on plus the migration cost of each migrated VM
+// uniform: every PM and every VM has the same cost (the allocators use a faster bound for this case)
+// else the costs are proportional to a capacity or a demand (e.g. migration cost proportional to the memory of the VM)
+class CostModel
+{
+	std::vector<double> m_activationCosts; // for each PM
+	std::vector<double> m_migrationCosts; // for each VM
+	double m_baseActivationCost; // activation cost of a PM (per unit of capacity if the cost is weighted)
+	double m_baseMigrationCost; // migration cost of a VM (per unit of demand if the cost is weighted)
+	bool m_uniform;
+
+public:
+	CostModel(const ProblemInstance& instance, const AllocatorParams& params);
+
+	bool isUniform() const
+	{
+		return m_uniform;
+	}
+
+	double baseActivationCost() const
+	{
+		return m_baseActivationCost;
+	}
+
+	double baseMigrationCost() const
+	{
+		return m_baseMigrationCost;
+	}
+
+	double activationCost(int pm) const
+	{
+		return m_activationCosts[pm];
+	}
+
+	double migrationCost(int vm) const
+	{
+		return m_migrationCosts[vm];
+	}
+
+	double cost(const ProblemInstance& instance, const std::vector<int>& placement) const;
+
+	// emptying a PM (instead of turning it on) saves its activation cost, but costs the migration of its VMs
+	struct EmptyingOption
+	{
+		double saving; // activation cost - migration costs
+		int numMigrations;
+	};
+	static double maximalSaving(std::vector<EmptyingOption>& options, int remainingMigrations);
+};
+
+#endif
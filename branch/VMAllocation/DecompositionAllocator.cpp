@@ -0,0 +1,581 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+#include "DecompositionAllocator.h"
+#include "BnBAllocator.h"
+#include "ThreadPool.h"
+
+DecompositionAllocator::DecompositionAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l)
+	:m_instance(instance), m_problem(instance), m_costModel(*instance, *pa), m_log(l), m_bestCost(-1), m_activeHosts(-1), m_migrations(-1), m_numNodes(0)
+{
+	std::shared_ptr<DecompositionParams> params = std::dynamic_pointer_cast<DecompositionParams>(pa);
+
+	if (!params)
+		std::cout << "Error: invalid parameters type for DecompositionAllocator." << std::endl;
+
+	m_params = *params;
+
+	m_numMaxMigrations = instance->numPMs / m_params.maxMigrationsRatio;
+}
+
+// groups the PMs by their cluster, and the VMs by the cluster of their initial PM
+// (all PMs form one cluster if the instance is not clustered)
+void DecompositionAllocator::createClusters()
+{
+	const ProblemInstance& instance = *m_instance;
+	std::map<int, int> indexOfCluster;
+	std::vector<int> clusterOfPM(instance.numPMs, 0);
+	for (int pm = 0; pm < instance.numPMs; pm++)
+	{
+		int id = instance.PMClusters.empty() ? 0 : instance.PMClusters[pm];
+		auto inserted = indexOfCluster.insert(std::make_pair(id, (int)indexOfCluster.size()));
+		clusterOfPM[pm] = inserted.first->second;
+	}
+
+	m_clusters.assign(indexOfCluster.size(), Cluster());
+	std::vector<std::vector<long long>> free(m_clusters.size(), std::vector<long long>(instance.dimension, 0)); // free capacity of each cluster
+	for (int pm = 0; pm < instance.numPMs; pm++)
+	{
+		m_clusters[clusterOfPM[pm]].PMs.push_back(pm);
+		for (int d = 0; d < instance.dimension; d++)
+			free[clusterOfPM[pm]][d] += instance.capacity(pm, d);
+	}
+
+	std::vector<int> newVMs;
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		if (instance.initialIDs[vm] < 0)
+		{
+			newVMs.push_back(vm);
+			continue;
+		}
+		int cluster = clusterOfPM[instance.initialIDs[vm]];
+		m_clusters[cluster].VMs.push_back(vm);
+		for (int d = 0; d < instance.dimension; d++)
+			free[cluster][d] -= instance.demand(vm, d);
+	}
+
+	// new VMs go to the cluster with the largest free capacity in its scarcest dimension
+	for (int vm : newVMs)
+	{
+		int bestCluster = 0;
+		long long bestFree = LLONG_MIN;
+		for (std::size_t cluster = 0; cluster < m_clusters.size(); cluster++)
+		{
+			long long scarcest = LLONG_MAX;
+			for (int d = 0; d < instance.dimension; d++)
+				scarcest = std::min(scarcest, free[cluster][d] - instance.demand(vm, d));
+			if (scarcest > bestFree)
+			{
+				bestFree = scarcest;
+				bestCluster = cluster;
+			}
+		}
+		m_clusters[bestCluster].VMs.push_back(vm);
+		for (int d = 0; d < instance.dimension; d++)
+			free[bestCluster][d] -= instance.demand(vm, d);
+	}
+}
+
+// splits each cluster into its connected components: a VM is connected to its initial PM and to the PMs it fits onto
+// the PMs of a capacity class are handled together (a VM fits onto all of them or none, the classes do not span clusters), the PMs no VM can use form one component in each cluster
+void DecompositionAllocator::splitComponents()
+{
+	const ProblemInstance& instance = *m_instance;
+	int numClasses;
+	std::vector<int> PMClass = instance.capacityClasses(numClasses);
+	std::vector<int> classRepresentatives(numClasses);
+	for (int pm = 0; pm < instance.numPMs; pm++)
+		classRepresentatives[PMClass[pm]] = pm;
+
+	std::vector<Cluster> components;
+	for (const auto& cluster : m_clusters)
+	{
+		// union-find over the VMs of the cluster and the capacity classes of its PMs
+		int numVMs = cluster.VMs.size();
+		std::map<int, int> nodeOfClass;
+		for (int pm : cluster.PMs)
+			nodeOfClass.insert(std::make_pair(PMClass[pm], numVMs + (int)nodeOfClass.size()));
+		std::vector<int> parent(numVMs + nodeOfClass.size());
+		std::iota(parent.begin(), parent.end(), 0);
+		auto find = [&parent](int node)
+		{
+			while (parent[node] != node)
+				node = parent[node] = parent[parent[node]];
+			return node;
+		};
+
+		for (int i = 0; i < numVMs; i++)
+		{
+			int vm = cluster.VMs[i];
+			if (instance.initialIDs[vm] >= 0)
+				parent[find(i)] = find(nodeOfClass[PMClass[instance.initialIDs[vm]]]);
+			for (const auto& node : nodeOfClass)
+			{
+				if (instance.fitsEmpty(vm, classRepresentatives[node.first]))
+					parent[find(i)] = find(node.second);
+			}
+		}
+
+		std::map<int, int> componentOfRoot;
+		for (int i = 0; i < numVMs; i++)
+		{
+			auto inserted = componentOfRoot.insert(std::make_pair(find(i), (int)components.size()));
+			if (inserted.second)
+				components.push_back(Cluster());
+			components[inserted.first->second].VMs.push_back(cluster.VMs[i]);
+		}
+		int unused = -1; // component of the PMs without VMs
+		for (int pm : cluster.PMs)
+		{
+			auto component = componentOfRoot.find(find(nodeOfClass[PMClass[pm]]));
+			if (component != componentOfRoot.end())
+			{
+				components[component->second].PMs.push_back(pm);
+				continue;
+			}
+			if (unused < 0)
+			{
+				unused = components.size();
+				components.push_back(Cluster());
+			}
+			components[unused].PMs.push_back(pm);
+		}
+	}
+	m_clusters = components;
+}
+
+// estimated cost of a cluster for each migration budget from 0 to maxMigrations (at most the number of VMs which can migrate)
+// the bound of the intelligent bounding at the root of the search (with partially emptied PMs), but the PMs which are
+// left on can not be less than the number needed for the total demand of the cluster
+std::vector<double> DecompositionAllocator::boundCurve(const Cluster& cluster, int maxMigrations)
+{
+	const ProblemInstance& instance = *m_instance;
+	std::unordered_map<int, int> indexOfPM;
+	for (std::size_t i = 0; i < cluster.PMs.size(); i++)
+		indexOfPM[cluster.PMs[i]] = i;
+
+	int minimalPMs = 0; // for the total demand in the dimension where the largest PM is the smallest compared to it
+	for (int d = 0; d < instance.dimension; d++)
+	{
+		long long demand = 0;
+		long long largest = 1;
+		for (int vm : cluster.VMs)
+			demand += instance.demand(vm, d);
+		for (int pm : cluster.PMs)
+			largest = std::max(largest, (long long)instance.capacity(pm, d));
+		minimalPMs = std::max(minimalPMs, (int)((demand + largest - 1) / largest));
+	}
+
+	std::vector<int> numInitialVMs(cluster.PMs.size(), 0);
+	std::vector<double> migrationCosts(cluster.PMs.size(), 0); // of the initial VMs of each PM
+	int numMigratable = 0;
+	for (int vm : cluster.VMs)
+	{
+		if (instance.initialIDs[vm] < 0)
+			continue;
+		int pm = indexOfPM[instance.initialIDs[vm]];
+		numInitialVMs[pm]++;
+		migrationCosts[pm] += m_costModel.migrationCost(vm);
+		numMigratable++;
+	}
+
+	double extraCost = 0;
+	int numPMsOn = 0;
+	std::vector<CostModel::EmptyingOption> options;
+	for (std::size_t i = 0; i < cluster.PMs.size(); i++)
+	{
+		if (numInitialVMs[i] == 0)
+			continue;
+		numPMsOn++;
+		double activationCost = m_costModel.activationCost(cluster.PMs[i]);
+		extraCost += activationCost;
+		if (activationCost > migrationCosts[i])
+			options.push_back({ activationCost - migrationCosts[i], numInitialVMs[i] });
+	}
+	std::sort(options.begin(), options.end(), [](const CostModel::EmptyingOption& o1, const CostModel::EmptyingOption& o2)
+	{
+		return o1.saving * o2.numMigrations > o2.saving * o1.numMigrations; // saving per migration, descending
+	});
+
+	// each further migration saves the saving per migration of the best option which is not used up yet
+	options.resize(std::min<int>(options.size(), std::max(0, numPMsOn - minimalPMs)));
+	std::vector<double> curve(std::min(maxMigrations, numMigratable) + 1, extraCost);
+	std::size_t option = 0;
+	int usedMigrations = 0; // of the current option
+	for (std::size_t budget = 1; budget < curve.size(); budget++)
+	{
+		curve[budget] = curve[budget - 1];
+		if (option == options.size())
+			continue;
+		curve[budget] -= options[option].saving / options[option].numMigrations;
+		if (++usedMigrations == options[option].numMigrations)
+		{
+			option++;
+			usedMigrations = 0;
+		}
+	}
+	return curve;
+}
+
+// migration budgets of the clusters minimizing the sum of their lower bounds, by dynamic programming over the clusters
+// only as many migrations are given to a cluster as lower its bound, so the sum of the budgets may be less than the limit
+// canSave: for each cluster, true if migrations can lower its bound at all
+std::vector<int> DecompositionAllocator::budgetsOfBoundCurves(std::vector<bool>& canSave)
+{
+	canSave.assign(m_clusters.size(), false);
+	int limit = std::max(0, m_numMaxMigrations);
+	std::vector<double> minimalBound(limit + 1, 0); // for each total budget: minimal sum of the bounds of the clusters so far
+	std::vector<std::vector<int>> budgetOfCluster(m_clusters.size()); // best budget of the cluster for each total budget (empty if it is always 0)
+	for (std::size_t i = 0; i < m_clusters.size(); i++)
+	{
+		std::vector<double> curve = boundCurve(m_clusters[i], limit);
+		canSave[i] = curve.back() < curve[0];
+		if (curve.size() == 1) // no VM of the cluster can migrate
+		{
+			for (double& bound : minimalBound)
+				bound += curve[0];
+			continue;
+		}
+		budgetOfCluster[i].assign(limit + 1, 0);
+		std::vector<double> next(limit + 1);
+		for (int total = 0; total <= limit; total++)
+		{
+			next[total] = minimalBound[total] + curve[0];
+			for (int budget = 1; budget <= total && budget < (int)curve.size(); budget++)
+			{
+				double bound = minimalBound[total - budget] + curve[budget];
+				if (bound < next[total] - 1e-9) // the smallest budget of the equal bounds
+				{
+					next[total] = bound;
+					budgetOfCluster[i][total] = budget;
+				}
+			}
+		}
+		minimalBound.swap(next);
+	}
+
+	std::vector<int> budgets(m_clusters.size());
+	int total = limit;
+	for (int i = (int)m_clusters.size() - 1; i >= 0; i--)
+	{
+		budgets[i] = budgetOfCluster[i].empty() ? 0 : budgetOfCluster[i][total];
+		total -= budgets[i];
+	}
+	return budgets;
+}
+
+// splits the migration limit among the clusters (largest remainder method), the clusters without VMs which can migrate get nothing
+// with BOUND, the rest of the budgets of the bound curves is split proportionally among the clusters whose bound migrations can lower
+// (among every cluster by its VMs which can migrate if there is no such cluster)
+void DecompositionAllocator::splitMigrationBudget()
+{
+	std::vector<int> baseBudgets(m_clusters.size(), 0);
+	std::vector<bool> canSave(m_clusters.size(), true);
+	if (m_params.budgetSplit == BOUND)
+		baseBudgets = budgetsOfBoundCurves(canSave);
+	int remaining = m_numMaxMigrations;
+	for (int budget : baseBudgets)
+		remaining -= budget;
+
+	std::vector<int> numMovable(m_clusters.size(), 0); // VMs with an initial PM, only these VMs can migrate
+	for (std::size_t i = 0; i < m_clusters.size(); i++)
+	{
+		for (int vm : m_clusters[i].VMs)
+		{
+			if (m_instance->initialIDs[vm] >= 0)
+				numMovable[i]++;
+		}
+	}
+
+	std::vector<double> weights(m_clusters.size(), 0);
+	double sumWeights = 0;
+	for (std::size_t i = 0; i < m_clusters.size(); i++)
+	{
+		if (numMovable[i] > 0)
+			weights[i] = (m_params.budgetSplit == EQUAL) ? 1 : (canSave[i] ? numMovable[i] : 0);
+		sumWeights += weights[i];
+	}
+	if (sumWeights == 0)
+	{
+		for (std::size_t i = 0; i < m_clusters.size(); i++)
+			weights[i] = numMovable[i];
+		sumWeights = std::accumulate(weights.begin(), weights.end(), 0.0);
+	}
+
+	int toSplit = (sumWeights > 0) ? remaining : 0;
+	std::vector<std::pair<double, int>> remainders; // fractional part of the share, cluster
+	for (std::size_t i = 0; i < m_clusters.size(); i++)
+	{
+		double share = (toSplit > 0) ? toSplit * weights[i] / sumWeights : 0;
+		m_clusters[i].migrationBudget = baseBudgets[i] + (int)share;
+		remaining -= (int)share;
+		if (weights[i] > 0)
+			remainders.push_back(std::make_pair(share - (int)share, (int)i));
+	}
+	std::sort(remainders.begin(), remainders.end(), std::greater<std::pair<double, int>>());
+	for (int i = 0; i < remaining && i < (int)remainders.size(); i++)
+		m_clusters[remainders[i].second].migrationBudget++;
+}
+
+// starting allocation of a cluster (PM indices in the cluster): the VMs stay on their PM in the incumbent (or in the initial
+// allocation without an incumbent) if it is in the cluster and they fit, the others are allocated first fit (PMs already on first)
+// so new VMs and invalid initial allocations get a starting allocation as well, returns an empty vector if some VM does not fit anywhere
+std::vector<int> DecompositionAllocator::startPlacement(const Cluster& cluster, const ProblemInstance& subInstance)
+{
+	const std::vector<int>& start = m_incumbent.empty() ? m_instance->initialIDs : m_incumbent;
+	std::map<int, int> subIndexOf;
+	for (std::size_t i = 0; i < cluster.PMs.size(); i++)
+		subIndexOf[cluster.PMs[i]] = i;
+
+	std::vector<int> placement(subInstance.numVMs, -1);
+	std::vector<long long> free(subInstance.capacities.begin(), subInstance.capacities.end());
+	std::vector<bool> on(subInstance.numPMs, false);
+	auto fits = [&](int vm, int pm)
+	{
+		for (int d = 0; d < subInstance.dimension; d++)
+		{
+			if (free[(std::size_t)d * subInstance.numPMs + pm] < subInstance.demand(vm, d))
+				return false;
+		}
+		return true;
+	};
+	auto place = [&](int vm, int pm)
+	{
+		for (int d = 0; d < subInstance.dimension; d++)
+			free[(std::size_t)d * subInstance.numPMs + pm] -= subInstance.demand(vm, d);
+		placement[vm] = pm;
+		on[pm] = true;
+	};
+
+	for (int vm = 0; vm < subInstance.numVMs; vm++)
+	{
+		auto pm = subIndexOf.find(start[cluster.VMs[vm]]);
+		if (pm != subIndexOf.end() && fits(vm, pm->second))
+			place(vm, pm->second);
+	}
+	for (int vm = 0; vm < subInstance.numVMs; vm++)
+	{
+		for (int pass = 0; pass < 2 && placement[vm] < 0; pass++) // first pass: PMs already on
+		{
+			for (int pm = 0; pm < subInstance.numPMs; pm++)
+			{
+				if (on[pm] == (pass == 0) && fits(vm, pm))
+				{
+					place(vm, pm);
+					break;
+				}
+			}
+		}
+		if (placement[vm] < 0)
+			return std::vector<int>();
+	}
+
+	return placement;
+}
+
+// solves the subproblem of one cluster, called from the worker threads
+// the clusters are disjoint, so the tasks only read shared data
+void DecompositionAllocator::solveCluster(Cluster& cluster)
+{
+	cluster.cost = -1;
+	cluster.nodes = 0;
+	if (cluster.VMs.empty())
+	{
+		cluster.cost = 0;
+		cluster.activeHosts = 0;
+		cluster.migrations = 0;
+		return;
+	}
+	if (cluster.PMs.empty()) // VMs which fit onto no PM
+		return;
+
+	auto subInstance = std::make_shared<const ProblemInstance>(m_instance->subInstance(cluster.VMs, cluster.PMs));
+	auto subParams = std::make_shared<BnBParams>(m_params);
+	subParams->timeout = std::max(0.0, m_params.timeout - m_timer.getElapsedTime()); // the pool may start the cluster late
+	std::ostream noLog(nullptr); // the sub-solvers are not logged (they run in parallel)
+	BnBAllocator subSolver(subInstance, subParams, noLog);
+	subSolver.setMaxMigrations(cluster.migrationBudget);
+
+	// the sub-solver starts from the part of the incumbent (or of the initial allocation) in this cluster, completed first fit
+	// (it ignores the start if it exceeds the migration budget of the cluster)
+	std::vector<int> start = startPlacement(cluster, *subInstance);
+	if (!start.empty())
+	{
+		AllocationProblem incumbentState(subInstance);
+		AllocationMapType incumbent;
+		for (std::size_t i = 0; i < cluster.VMs.size(); i++)
+			incumbent[&incumbentState.VMs[i]] = &incumbentState.PMs[start[i]];
+		subSolver.setIncumbent(incumbent);
+	}
+
+	subSolver.solve();
+	cluster.nodes = subSolver.getNodeCount();
+	cluster.cost = subSolver.getBestCost();
+	if (cluster.cost < 0)
+	{
+		// no result within the budget or the time: the start is used, the merged allocation is checked against the whole migration limit
+		if (start.empty())
+			return;
+		std::vector<bool> on(subInstance->numPMs, false);
+		cluster.placement = start;
+		cluster.cost = CostModel(*subInstance, m_params).cost(*subInstance, start);
+		cluster.activeHosts = 0;
+		cluster.migrations = 0;
+		for (int vm = 0; vm < subInstance->numVMs; vm++)
+		{
+			if (!on[start[vm]])
+				cluster.activeHosts++;
+			on[start[vm]] = true;
+			if (subInstance->initialIDs[vm] >= 0 && subInstance->initialIDs[vm] != start[vm])
+				cluster.migrations++;
+		}
+		return;
+	}
+
+	cluster.placement.resize(cluster.VMs.size());
+	for (const auto& iter : subSolver.getBestAllocation())
+		cluster.placement[iter.first->id] = iter.second->id;
+	cluster.activeHosts = subSolver.getActiveHosts();
+	cluster.migrations = subSolver.getMigrations();
+}
+
+// solves the allocation problem and stores the results in member variables
+void DecompositionAllocator::solve()
+{
+	m_timer.start();
+
+	createClusters();
+	int numClusters = m_clusters.size();
+	splitComponents();
+	splitMigrationBudget();
+
+	// the largest clusters are started first, so the pool does not wait for a large one at the end
+	std::vector<int> order(m_clusters.size());
+	for (std::size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [this](int c1, int c2)
+	{
+		return m_clusters[c1].VMs.size() > m_clusters[c2].VMs.size();
+	});
+
+	{
+		ThreadPool pool(std::min(std::max(1, m_params.numThreads), (int)m_clusters.size()));
+		for (int cluster : order)
+			pool.submit([this, cluster] {solveCluster(m_clusters[cluster]); });
+		pool.wait();
+	}
+
+	// merging the allocations of the clusters
+	double cost = 0;
+	int activeHosts = 0;
+	int migrations = 0;
+	bool complete = true;
+	for (const auto& cluster : m_clusters)
+	{
+		m_numNodes += cluster.nodes;
+		if (cluster.cost < 0)
+		{
+			complete = false;
+			continue;
+		}
+		cost += cluster.cost;
+		activeHosts += cluster.activeHosts;
+		migrations += cluster.migrations;
+	}
+
+	#ifdef VERBOSE_BASIC
+		m_log << "Decomposition: " << numClusters << " clusters, " << m_clusters.size() << " components" << std::endl;
+		for (std::size_t i = 0; i < m_clusters.size(); i++)
+			m_log << "\tcomponent " << i << ": " << m_clusters[i].VMs.size() << " VMs, " << m_clusters[i].PMs.size() << " PMs, migration budget: " << m_clusters[i].migrationBudget << ", cost: " << m_clusters[i].cost << std::endl;
+	#endif
+
+	if (!complete)
+		return;
+	if (migrations > m_numMaxMigrations)
+	{
+		m_log << "WARNING: the starting allocations of the clusters exceed the migration limit, no allocation is returned." << std::endl;
+		return;
+	}
+
+	for (const auto& cluster : m_clusters)
+	{
+		for (std::size_t i = 0; i < cluster.VMs.size(); i++)
+			m_bestAllocation[&m_problem.VMs[cluster.VMs[i]]] = &m_problem.PMs[cluster.PMs[cluster.placement[i]]];
+	}
+	m_bestCost = cost;
+	m_activeHosts = activeHosts;
+	m_migrations = migrations;
+}
+
+// returns the cost of the best allocation found, or -1 when no allocation was found (in any of the clusters)
+double DecompositionAllocator::getBestCost()
+{
+	#ifdef VERBOSE_BASIC
+		m_log << "alloc:\t";
+		std::vector<int> PMOfVM(m_instance->numVMs, -1);
+		for (const auto& iter : m_bestAllocation)
+			PMOfVM[iter.first->id] = iter.second->id;
+		for (int vm = 0; vm < (int)PMOfVM.size() && !m_bestAllocation.empty(); vm++)
+			m_log << vm << "->" << PMOfVM[vm] << " ";
+		m_log << std::endl;
+	#endif
+
+	return (m_bestAllocation.empty()) ? -1 : m_bestCost;
+}
+
+const AllocationMapType& DecompositionAllocator::getBestAllocation()
+{
+	return m_bestAllocation;
+}
+
+int DecompositionAllocator::getActiveHosts()
+{
+	return m_activeHosts;
+}
+
+int DecompositionAllocator::getMigrations()
+{
+	return m_migrations;
+}
+
+long long DecompositionAllocator::getNodeCount()
+{
+	return m_numNodes;
+}
+
+// the incumbent is split among the clusters, each sub-solver starts from its part (if it stays in the cluster)
+// must be called before the start of the algorithm
+void DecompositionAllocator::setIncumbent(const AllocationMapType& allocation)
+{
+	m_incumbent.assign(m_instance->numVMs, -1);
+	for (const auto& iter : allocation)
+	{
+		if (iter.first->id < m_instance->numVMs)
+			m_incumbent[iter.first->id] = iter.second->id;
+	}
+}
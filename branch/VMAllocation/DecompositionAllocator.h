@@ -0,0 +1,90 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DECOMPOSITIONALLOCATOR_H
+#define DECOMPOSITIONALLOCATOR_H
+
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "VMAllocator.h"
+#include "AllocationProblem.h"
+#include "DecompositionParams.h"
+#include "CostModel.h"
+#include "Timer.h"
+
+// solves each PM cluster (e.g. rack) as an independent subproblem with its own BnBAllocator on a thread pool
+// VMs never leave the cluster of their initial PM, new VMs are assigned to the cluster with the most free capacity
+// the clusters are split further into their connected components (the VMs with the PMs they fit onto), which are independent as well
+// the migration limit is split among the clusters, so the merged allocation respects the limit of the whole problem
+class DecompositionAllocator : public VMAllocator
+{
+	struct Cluster
+	{
+		std::vector<int> VMs;
+		std::vector<int> PMs;
+		int migrationBudget;
+
+		// result of the sub-solver
+		double cost; // -1 if no allocation was found
+		std::vector<int> placement; // PM index (in the cluster) of each VM of the cluster
+		int activeHosts;
+		int migrations;
+		long long nodes;
+	};
+
+	ProblemInstancePtr m_instance;
+	AllocationProblem m_problem; // VM and PM objects of the merged allocation
+	DecompositionParams m_params; // algorithm parameters
+	CostModel m_costModel;
+	std::ostream& m_log; // output log
+	Timer m_timer;
+
+	int m_numMaxMigrations;
+	std::vector<Cluster> m_clusters;
+	std::vector<int> m_incumbent; // PM of each VM in the incumbent (empty if there is none)
+
+	double m_bestCost;
+	AllocationMapType m_bestAllocation;
+	int m_activeHosts;
+	int m_migrations;
+	long long m_numNodes;
+
+	void createClusters();
+	void splitComponents();
+	std::vector<double> boundCurve(const Cluster& cluster, int maxMigrations);
+	std::vector<int> budgetsOfBoundCurves(std::vector<bool>& canSave);
+	void splitMigrationBudget();
+	std::vector<int> startPlacement(const Cluster& cluster, const ProblemInstance& subInstance);
+	void solveCluster(Cluster& cluster);
+
+public:
+	DecompositionAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l);
+	void solve() final override;
+	double getBestCost() final override;
+	const AllocationMapType& getBestAllocation() final override;
+	int getActiveHosts() final override;
+	int getMigrations() final override;
+	long long getNodeCount() final override;
+	void setIncumbent(const AllocationMapType& allocation) final override;
+};
+
+#endif
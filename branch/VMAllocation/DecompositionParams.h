@@ -0,0 +1,64 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DECOMPOSITIONPARAMS_H
+#define DECOMPOSITIONPARAMS_H
+
+#include <string>
+#include <iostream>
+
+#include "BnBParams.h"
+
+enum BudgetSplitType
+{
+	PROPORTIONAL, // the migration budget of a cluster is proportional to its number of VMs
+	EQUAL, // every cluster gets the same migration budget
+	BOUND // the budget minimizing the sum of the lower bounds of the clusters, the rest is proportional
+};
+
+// the BnB parameters are used by the sub-solvers of the clusters
+struct DecompositionParams : public BnBParams
+{
+	int numThreads; // size of the thread pool solving the clusters
+	BudgetSplitType budgetSplit; // split of the migration limit among the clusters
+};
+
+static BudgetSplitType stringToBudgetSplitType(const std::string& toConvert)
+{
+	if (toConvert == "PROPORTIONAL")
+	{
+		return PROPORTIONAL;
+	}
+	else if (toConvert == "EQUAL")
+	{
+		return EQUAL;
+	}
+	else if (toConvert == "BOUND")
+	{
+		return BOUND;
+	}
+	else
+	{
+		std::cout << "WARNING: Invalid Budget Split Type. Defaulting to PROPORTIONAL." << std::endl;
+		return PROPORTIONAL;
+	}
+}
+
+#endif
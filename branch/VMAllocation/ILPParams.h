@@ -33,6 +33,8 @@ enum SolverType
 struct ILPParams : public AllocatorParams
 {
 	SolverType solverType;
+
+	bool aggregatedLinking; // link Alloc and Active variables through the capacity constraints instead of one row per VM-PM pair
 };
 
 static SolverType stringToSolverType(const std::string& toConvert)
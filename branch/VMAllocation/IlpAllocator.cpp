@@ -20,15 +20,16 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include  <stdlib.h>
 #include  <math.h>
 #include  <sstream>
+#include  <cstdio>
+#include  <algorithm>
+#include  <chrono>
 
 #include  "ILPAllocator.h"
 
-using std::ofstream;
 using std::ifstream;
-using std::endl;
 
-ILPAllocator::ILPAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams> pa, std::ofstream& l)
-	:m_problem(pr), m_log(l)
+ILPAllocator::ILPAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l)
+	:m_problem(instance), m_costModel(*instance, *pa), m_log(l), m_incumbentCost(-1), m_bestCost(-1), m_activeHosts(-1), m_migrations(-1)
 {
 	std::shared_ptr<ILPParams> params = std::dynamic_pointer_cast<ILPParams>(pa);
 
@@ -40,57 +41,126 @@ ILPAllocator::ILPAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams
 	m_solverType = m_params.solverType;
 	m_numVMs = m_problem.VMs.size();
 	m_numPMs = m_problem.PMs.size();
-	m_dimension = m_problem.VMs[0].demand.size(); // only works if all VMs have the same number of dimensions
+	m_dimension = instance->dimension;
+
+	// only VM-PM pairs which fit together (and are in the same cluster) get a variable in the model
+	m_feasiblePMs.resize(m_numVMs);
+	m_feasibleVMs.resize(m_numPMs);
+	for(int j=0;j<m_numVMs;j++)
+	{
+		for(int i=0;i<m_numPMs;i++)
+		{
+			if(instance->inCluster(j,i) && VMFitsInPM(m_problem.VMs[j], m_problem.PMs[i]))
+			{
+				m_feasiblePMs[j].push_back(i);
+				m_feasibleVMs[i].push_back(j);
+			}
+		}
+	}
 }
 
-void ILPAllocator::create_lp(char *filename)
+// returns true if the VM fits in the empty PM
+bool ILPAllocator::VMFitsInPM(const VM& vm, const PM& pm)
 {
-	ofstream ilpfile(filename);
+	for(int d=0;d<m_dimension;d++)
+	{
+		if(m_problem.instance->demand(vm.id,d)>m_problem.instance->capacity(pm.id,d))
+			return false;
+	}
+	return true;
+}
 
-	//Objective function
-	if(m_solverType==GUROBI)
-		ilpfile << "Minimize" << endl;
-	if(m_solverType==LPSOLVE)
-		ilpfile << "min: ";
+// writes the terms of the objective function
+void ILPAllocator::writeObjective(BufferedWriter& ilpfile)
+{
+	bool firstTerm=true;
 	for(int i=0;i<m_numPMs;i++)
 	{
-		if(i>0) ilpfile << " + ";
-		ilpfile << COEFF_NR_OF_ACTIVE_HOSTS << " Active_" << i;
+		if(m_feasibleVMs[i].empty()) continue;
+		if(!firstTerm) ilpfile << " + ";
+		ilpfile << m_costModel.activationCost(i) << " Active_" << i;
+		firstTerm=false;
 	}
-	for(int i=0;i<m_numVMs;i++)
+	for(int j=0;j<m_numVMs;j++)
 	{
-		ilpfile << " + " << COEFF_NR_OF_MIGRATIONS << " Migr_" << i;
+		if(m_problem.VMs[j].initialID<0) continue;
+		ilpfile << " + " << m_costModel.migrationCost(j) << " Migr_" << j;
 	}
+}
+
+void ILPAllocator::create_lp(const char *filename)
+{
+	BufferedWriter ilpfile(filename);
+	const char* rowEnd = (m_solverType==LPSOLVE) ? ";\n" : "\n";
+
+	// PMs without any fitting VM are always off, they are left out of the model
+	// VMs without an initial PM can not migrate, they get no Migr variable
+	bool firstTerm=true;
+
+	//Objective function
+	if(m_solverType==GUROBI)
+		ilpfile << "Minimize\n";
+	if(m_solverType==LPSOLVE)
+		ilpfile << "min: ";
+	writeObjective(ilpfile);
 
 	if(m_solverType==GUROBI)
-		ilpfile << endl << endl << "Subject To" << endl;
+		ilpfile << "\n\nSubject To\n";
 	if(m_solverType==LPSOLVE)
-		ilpfile << ";" << endl << endl;
+		ilpfile << ";\n\n";
+
+	//Objective cutoff: only solutions at least as good as the incumbent are interesting
+	//(Gurobi gets it as a parameter instead)
+	if(m_solverType==LPSOLVE && !m_startPMs.empty())
+	{
+		ilpfile << "cutoff: ";
+		writeObjective(ilpfile);
+		ilpfile << " <= " << m_incumbentCost << rowEnd;
+	}
 
 	//Each VM must be allocated to exactly one PM
 	for(int j=0;j<m_numVMs;j++)
 	{
-		for(int i=0;i<m_numPMs;i++)
+		if(m_feasiblePMs[j].empty()) continue; // problem is infeasible, solve() does not call the solver
+		for(size_t k=0;k<m_feasiblePMs[j].size();k++)
 		{
-			if(i>0) ilpfile << " + ";
-			ilpfile << "Alloc_" << j << "_" << i;
+			if(k>0) ilpfile << " + ";
+			ilpfile << "Alloc_" << j << "_" << m_feasiblePMs[j][k];
 		}
-		if(m_solverType==GUROBI)
-			ilpfile << " = 1" << endl;
-		if(m_solverType==LPSOLVE)
-			ilpfile << " = 1;" << endl;
+		ilpfile << " = 1" << rowEnd;
 	}
 
 	//If a PM hosts at least one VM, then it must be active
-	for(int j=0;j<m_numVMs;j++)
+	for(int i=0;i<m_numPMs;i++)
 	{
-		for(int i=0;i<m_numPMs;i++)
+		const std::vector<int>& vms=m_feasibleVMs[i];
+		if(!m_params.aggregatedLinking)
+		{
+			for(size_t k=0;k<vms.size();k++)
+			{
+				ilpfile << "Alloc_" << vms[k] << "_" << i << " - Active_" << i << " <= 0" << rowEnd;
+			}
+			continue;
+		}
+
+		// aggregated version: the capacity constraints below contain the Active variable,
+		// only VMs without any demand need an explicit row
+		int numZeroDemandVMs=0;
+		for(size_t k=0;k<vms.size();k++)
+		{
+			bool zeroDemand=true;
+			for(int d=0;d<m_dimension;d++)
+				if(m_problem.instance->demand(vms[k],d)!=0) zeroDemand=false;
+			if(zeroDemand) numZeroDemandVMs++;
+		}
+		if(numZeroDemandVMs>0)
 		{
-			ilpfile << "Alloc_" << j << "_" << i << " - Active_" << i << " <= 0";
-			if(m_solverType==GUROBI)
-				ilpfile << endl;
-			if(m_solverType==LPSOLVE)
-				ilpfile << ";" << endl;
+			for(size_t k=0;k<vms.size();k++)
+			{
+				if(k>0) ilpfile << " + ";
+				ilpfile << "Alloc_" << vms[k] << "_" << i;
+			}
+			ilpfile << " - " << (int)vms.size() << " Active_" << i << " <= 0" << rowEnd;
 		}
 	}
 
@@ -99,131 +169,332 @@ void ILPAllocator::create_lp(char *filename)
 	{
 		for(int i=0;i<m_numPMs;i++)
 		{
-			int pmsize=m_problem.PMs[i].capacity[d];
+			const std::vector<int>& vms=m_feasibleVMs[i];
+			if(vms.empty()) continue;
+			int pmsize=m_problem.instance->capacity(i,d);
 			ilpfile << "dim_" << d << "_PM_" << i << ": ";
-			for(int j=0;j<m_numVMs;j++)
+			for(size_t k=0;k<vms.size();k++)
 			{
-				int vmsize=m_problem.VMs[j].demand[d];
-				if(j>0) ilpfile << " + ";
-				ilpfile << vmsize << " Alloc_" << j << "_" << i;
+				int vmsize=m_problem.instance->demand(vms[k],d);
+				if(k>0) ilpfile << " + ";
+				ilpfile << vmsize << " Alloc_" << vms[k] << "_" << i;
 			}
-			ilpfile << " <= " << pmsize;
-			if(m_solverType==GUROBI)
-				ilpfile << endl;
-			if(m_solverType==LPSOLVE)
-				ilpfile << ";" << endl;
+			if(m_params.aggregatedLinking)
+				ilpfile << " - " << pmsize << " Active_" << i << " <= 0" << rowEnd;
+			else
+				ilpfile << " <= " << pmsize << rowEnd;
 		}
 	}
 
 	//Migrations
+	bool anyMigration=false;
 	for(int j=0;j<m_numVMs;j++)
 	{
 		int initial=m_problem.VMs[j].initialID;
-		ilpfile << "Alloc_" << j << "_" << initial << " + Migr_" << j << " = 1";
-		if(m_solverType==GUROBI)
-			ilpfile << endl;
-		if(m_solverType==LPSOLVE)
-			ilpfile << ";" << endl;
+		if(initial<0) continue;
+		anyMigration=true;
+		if(m_feasibleVMs[initial].empty() || !VMFitsInPM(m_problem.VMs[j], m_problem.PMs[initial]))
+			ilpfile << "Migr_" << j << " = 1" << rowEnd; // cannot stay on its initial PM
+		else
+			ilpfile << "Alloc_" << j << "_" << initial << " + Migr_" << j << " = 1" << rowEnd;
 	}
-	for(int j=0;j<m_numVMs;j++)
+	if(anyMigration)
 	{
-		if(j>0) ilpfile << " + ";
-		ilpfile << "Migr_" << j;
+		firstTerm=true;
+		for(int j=0;j<m_numVMs;j++)
+		{
+			if(m_problem.VMs[j].initialID<0) continue;
+			if(!firstTerm) ilpfile << " + ";
+			ilpfile << "Migr_" << j;
+			firstTerm=false;
+		}
+		ilpfile << " <= " << m_numPMs/m_params.maxMigrationsRatio << rowEnd;
 	}
-	ilpfile << " <= " << m_numPMs/m_params.maxMigrationsRatio;
-	if(m_solverType==GUROBI)
-		ilpfile << endl;
-	if(m_solverType==LPSOLVE)
-		ilpfile << ";" << endl;
 
 	//Variables
+	const char* separator = (m_solverType==LPSOLVE) ? ", " : " ";
 	if(m_solverType==GUROBI)
-		ilpfile << endl << "Binary" << endl;
+		ilpfile << "\nBinary\n";
 	if(m_solverType==LPSOLVE)
-		ilpfile << endl << "bin ";
+		ilpfile << "\nbin ";
+	firstTerm=true;
 	for(int j=0;j<m_numVMs;j++)
 	{
-		if(j>0)
-		{
-			if(m_solverType==GUROBI)
-				ilpfile << " ";
-			if(m_solverType==LPSOLVE)
-				ilpfile << ", ";
-		}
+		if(m_problem.VMs[j].initialID<0) continue;
+		if(!firstTerm) ilpfile << separator;
 		ilpfile << "Migr_" << j;
+		firstTerm=false;
 	}
 	for(int i=0;i<m_numPMs;i++)
 	{
-		if(m_solverType==LPSOLVE)
-			ilpfile << ",";
-		ilpfile << " Active_" << i;
+		if(m_feasibleVMs[i].empty()) continue;
+		if(!firstTerm) ilpfile << separator;
+		ilpfile << "Active_" << i;
+		firstTerm=false;
 	}
 	for(int j=0;j<m_numVMs;j++)
 	{
-		for(int i=0;i<m_numPMs;i++)
+		for(size_t k=0;k<m_feasiblePMs[j].size();k++)
 		{
-			if(m_solverType==LPSOLVE)
-				ilpfile << ",";
-			ilpfile << " Alloc_" << j << "_" << i;
+			if(!firstTerm) ilpfile << separator;
+			ilpfile << "Alloc_" << j << "_" << m_feasiblePMs[j][k];
+			firstTerm=false;
 		}
 	}
 	if(m_solverType==GUROBI)
-		ilpfile << endl << "End" << endl;
+		ilpfile << "\nEnd\n";
 	if(m_solverType==LPSOLVE)
-		ilpfile << ";" << endl;
+		ilpfile << ";\n";
 
 	ilpfile.close();
 }
 
+// writes the starting incumbent as variable values (Gurobi MIP start and lp_solve guess vector use the same "name value" lines)
+void ILPAllocator::create_start(const char *filename)
+{
+	BufferedWriter startfile(filename);
+	std::vector<bool> active(m_numPMs, false);
+
+	if(m_solverType==GUROBI)
+		startfile << "# MIP start\n";
+	for(int j=0;j<m_numVMs;j++)
+	{
+		for(size_t k=0;k<m_feasiblePMs[j].size();k++)
+		{
+			int i=m_feasiblePMs[j][k];
+			startfile << "Alloc_" << j << "_" << i << " " << (i==m_startPMs[j] ? 1 : 0) << "\n";
+		}
+		active[m_startPMs[j]]=true;
+		if(m_problem.VMs[j].initialID>=0)
+			startfile << "Migr_" << j << " " << (m_startPMs[j]!=m_problem.VMs[j].initialID ? 1 : 0) << "\n";
+	}
+	for(int i=0;i<m_numPMs;i++)
+	{
+		if(m_feasibleVMs[i].empty()) continue;
+		startfile << "Active_" << i << " " << (active[i] ? 1 : 0) << "\n";
+	}
+
+	startfile.close();
+}
+
+void ILPAllocator::setIncumbent(const AllocationMapType& allocation)
+{
+	// VMs and PMs are matched by id, the ids are the indices of the instance
+	std::vector<int> startPMs(m_numVMs, -1);
+	std::vector<int> VMIndexOfId(m_numVMs, -1);
+	std::vector<int> PMIndexOfId(m_numPMs, -1);
+	for(int j=0;j<m_numVMs;j++)
+		VMIndexOfId[m_problem.VMs[j].id]=j;
+	for(int i=0;i<m_numPMs;i++)
+		PMIndexOfId[m_problem.PMs[i].id]=i;
+
+	for(const auto& iter : allocation)
+	{
+		int VMId=iter.first->id;
+		int PMId=iter.second->id;
+		if(VMId<0 || VMId>=m_numVMs || PMId<0 || PMId>=m_numPMs)
+		{
+			m_log << "WARNING: incumbent refers to a VM or PM which is not in the problem, it is not used as a MIP start." << std::endl;
+			return;
+		}
+		startPMs[VMIndexOfId[VMId]]=PMIndexOfId[PMId];
+	}
+
+	// only complete allocations of feasible pairs can be used
+	for(int j=0;j<m_numVMs;j++)
+	{
+		if(startPMs[j]<0 || std::find(m_feasiblePMs[j].begin(), m_feasiblePMs[j].end(), startPMs[j])==m_feasiblePMs[j].end())
+		{
+			m_log << "WARNING: incumbent is not a complete allocation, it is not used as a MIP start." << std::endl;
+			return;
+		}
+	}
+
+	m_startPMs=startPMs;
+	m_incumbentCost=m_costModel.cost(*m_problem.instance, startPMs);
+}
+
 void ILPAllocator::solve()
 {
+	// removing the result of a previous run, so that it is not mistaken for the current one
+	std::remove("sol_gurobi.sol");
+	std::remove("sol_lpsolve.sol");
+	std::remove("gurobi_ilp.log");
+	m_bestAllocation.clear();
+	m_bestCost=-1;
+	m_activeHosts=-1;
+	m_migrations=-1;
+	m_stats.nodes=-1;
+	m_stats.mipGap=-1;
+	m_stats.solveTime=-1;
+
+	for(int j=0;j<m_numVMs;j++)
+	{
+		if(m_feasiblePMs[j].empty())
+		{
+			m_log << "VM " << m_problem.VMs[j].id << " does not fit into any PM, the problem is infeasible." << std::endl;
+			return;
+		}
+	}
+
 	std::ostringstream command;
 	if(m_solverType==GUROBI)
 	{
 		create_lp("ilp_gurobi.lp");
-		command << "gurobi_cl Threads=1 ResultFile=sol_gurobi.sol TimeLimit=" << m_params.timeout << " ilp_gurobi.lp";
+		command << "gurobi_cl Threads=1 ResultFile=sol_gurobi.sol LogFile=gurobi_ilp.log TimeLimit=" << m_params.timeout;
+		if(!m_startPMs.empty())
+		{
+			// costs are integers, so everything above incumbent + 0.5 is worse than the incumbent,
+			// while the incumbent itself is still reported when it turns out to be optimal
+			create_start("ilp_gurobi.mst");
+			command << " InputFile=ilp_gurobi.mst Cutoff=" << m_incumbentCost+0.5;
+		}
+		command << " ilp_gurobi.lp";
 	}
 	if(m_solverType==LPSOLVE)
 	{
 		create_lp("ilp_lpsolve.lp");
-		command << LPSOLVEPATH << " -timeout " << (int)round(m_params.timeout) << " ilp_lpsolve.lp > sol_lpsolve.sol";
+		command << LPSOLVEPATH << " -timeout " << (int)round(m_params.timeout);
+		if(!m_startPMs.empty())
+		{
+			create_start("ilp_lpsolve.guess");
+			command << " -gb ilp_lpsolve.guess";
+		}
+		command << " ilp_lpsolve.lp > sol_lpsolve.sol";
 	}
+
+	// the solver runs in a child process, its runtime is measured in wall-clock time
+	auto solverStart=std::chrono::steady_clock::now();
 	system(command.str().c_str());
+	m_stats.solveTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-solverStart).count();
+
+	readSolution();
+	readStats();
+
+	m_log << "ILP statistics: nodes = " << m_stats.nodes << ", MIP gap = " << m_stats.mipGap << ", solve time = " << m_stats.solveTime << std::endl;
 }
 
-// returns the cost of the best allocation found, or -1 when no allocation was found
-double ILPAllocator::getBestCost()
+// reads the objective value and the allocation from the solution file of the solver, and the statistics from its log
+void ILPAllocator::readSolution()
 {
-	double result=-1;
 	std::string line;
-	if(m_solverType==GUROBI)
+	bool variablesListed=false; // lp_solve: the lines after "Actual values of the variables:" are variable values
+	ifstream solfile(m_solverType==GUROBI ? "sol_gurobi.sol" : "sol_lpsolve.sol");
+	std::vector<int> solutionPMs(m_numVMs, -1);
+	while(std::getline(solfile, line))
 	{
-		ifstream solfile("sol_gurobi.sol");
-		std::getline(solfile, line);
-		try
+		if(m_solverType==GUROBI && line.find("# Objective value = ")==0)
+		{
+			m_bestCost=atof(line.substr(20).c_str());
+			continue;
+		}
+		if(m_solverType==LPSOLVE)
+		{
+			if(line.find("Value of objective function: ")==0)
+			{
+				m_bestCost=atof(line.substr(29).c_str());
+				continue;
+			}
+			if(line.find("Actual values of the variables")==0)
+			{
+				variablesListed=true;
+				continue;
+			}
+			if(line.find("Actual values of the constraints")==0)
+			{
+				variablesListed=false;
+				continue;
+			}
+			if(!variablesListed)
+				continue;
+		}
+
+		// "Alloc_j_i value" lines
+		int j, i;
+		double value;
+		if(sscanf(line.c_str(), "Alloc_%d_%d %lf", &j, &i, &value)==3 && value>0.5 && j>=0 && j<m_numVMs && i>=0 && i<m_numPMs)
 		{
-			result = atof(line.substr(20).c_str());
+			solutionPMs[j]=i;
 		}
-		catch (std::out_of_range&)
+	}
+	solfile.close();
+
+	if(m_bestCost<0)
+		return;
+
+	// building the allocation and its cost components
+	std::vector<bool> active(m_numPMs, false);
+	m_migrations=0;
+	for(int j=0;j<m_numVMs;j++)
+	{
+		if(solutionPMs[j]<0)
 		{
-			// no solution given
+			m_log << "WARNING: VM " << m_problem.VMs[j].id << " is not allocated in the solution file." << std::endl;
+			m_bestAllocation.clear();
+			m_migrations=-1;
+			return;
 		}
-//		solfile >> "# Objective value =" >> result;
-		solfile.close();
+		m_bestAllocation[&m_problem.VMs[j]]=&m_problem.PMs[solutionPMs[j]];
+		active[solutionPMs[j]]=true;
+		if(m_problem.VMs[j].initialID>=0 && solutionPMs[j]!=m_problem.VMs[j].initialID)
+			m_migrations++;
 	}
-	if(m_solverType==LPSOLVE)
+	m_activeHosts=std::count(active.begin(), active.end(), true);
+}
+
+// reads the number of explored nodes, the MIP gap and the runtime from the Gurobi log
+// (lp_solve does not report these, only the measured runtime is available for it)
+void ILPAllocator::readStats()
+{
+	if(m_solverType!=GUROBI)
+		return;
+
+	std::string line;
+	ifstream logfile("gurobi_ilp.log");
+	while(std::getline(logfile, line))
 	{
-		ifstream solfile("sol_lpsolve.sol");
-		while(std::getline(solfile, line))
+		double nodes, seconds, gap;
+		char bound[32];
+		if(sscanf(line.c_str(), "Explored %lf nodes (%*f simplex iterations) in %lf seconds", &nodes, &seconds)==2)
 		{
-			if(line.find("Value of objective function: ")==0)
-			{
-				result=atof(line.substr(29).c_str());
-				break;
-			}
+			m_stats.nodes=(long long)nodes;
+			m_stats.solveTime=seconds;
+		}
+		else if(sscanf(line.c_str(), "Best objective %*[^,], best bound %31[^,], gap %lf%%", bound, &gap)==2)
+		{
+			m_stats.mipGap=gap/100;
 		}
-		solfile.close();
 	}
-	return result;
+	logfile.close();
 }
 
+// returns the cost of the best allocation found, or -1 when no allocation was found
+double ILPAllocator::getBestCost()
+{
+	return m_bestCost;
+}
+
+const AllocationMapType& ILPAllocator::getBestAllocation()
+{
+	return m_bestAllocation;
+}
+
+int ILPAllocator::getActiveHosts()
+{
+	return m_activeHosts;
+}
+
+int ILPAllocator::getMigrations()
+{
+	return m_migrations;
+}
+
+long long ILPAllocator::getNodeCount()
+{
+	return m_stats.nodes;
+}
+
+const ILPAllocator::ILPStats& ILPAllocator::getStats()
+{
+	return m_stats;
+}
@@ -22,31 +22,66 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include "VMAllocator.h"
 #include "AllocationProblem.h"
 #include "AllocatorParams.h"
 #include "ILPParams.h"
+#include "BufferedWriter.h"
 
 #define LPSOLVEPATH "lp_solve_5.5.2.0_exe\\lp_solve"
 
 class ILPAllocator : public VMAllocator
 {
-	AllocationProblem m_problem; // the allocation problem
+public:
+	struct ILPStats
+	{
+		long long nodes; // number of explored branch and bound nodes, -1 if unknown
+		double mipGap; // relative gap between the best solution and the best bound, -1 if unknown
+		double solveTime; // runtime of the solver in seconds
+	};
+private:
+	AllocationProblem m_problem; // the allocation problem (own state on the shared instance)
 	ILPParams m_params; // algorithm parameters
-	std::ofstream& m_log; // output log file
+	CostModel m_costModel;
+	std::ostream& m_log; // output log
 	SolverType m_solverType;
 
 	int m_dimension; // dimension of resources
 	int m_numVMs; // number of Virtual Machines
 	int m_numPMs; // number of Physical Machines
 
-	void create_lp(char *filename);
+	std::vector<std::vector<int>> m_feasiblePMs; // for each VM: indices of the PMs it fits into when empty
+	std::vector<std::vector<int>> m_feasibleVMs; // for each PM: indices of the VMs fitting into it when empty
+
+	std::vector<int> m_startPMs; // for each VM: index of its PM in the starting incumbent (empty if there is no incumbent)
+	double m_incumbentCost; // cost of the starting incumbent
+
+	AllocationMapType m_bestAllocation; // allocation read from the solution file
+	double m_bestCost;
+	int m_activeHosts;
+	int m_migrations;
+	ILPStats m_stats;
+
+	bool VMFitsInPM(const VM& vm, const PM& pm);
+	void writeObjective(BufferedWriter& ilpfile);
+	void create_lp(const char *filename);
+	void create_start(const char *filename);
+	void readSolution();
+	void readStats();
 
 public:
-	ILPAllocator(AllocationProblem pr, std::shared_ptr<AllocatorParams> pa, std::ofstream& l);
+	ILPAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l);
 	void solve() final override;
 	double getBestCost() final override;
+	const AllocationMapType& getBestAllocation() final override;
+	int getActiveHosts() final override;
+	int getMigrations() final override;
+	long long getNodeCount() final override;
+	void setIncumbent(const AllocationMapType& allocation) final override;
+
+	const ILPStats& getStats();
 };
 
 #endif /* ILPALLOCATOR_H */
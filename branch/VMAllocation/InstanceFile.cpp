@@ -0,0 +1,326 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "InstanceFile.h"
+#include "BufferedWriter.h"
+
+InstanceFile::InstanceFile()
+	:m_data(nullptr), m_size(0), m_header(nullptr)
+{
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#endif
+}
+
+InstanceFile::~InstanceFile()
+{
+	unmap();
+}
+
+void InstanceFile::unmap()
+{
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_fileHandle);
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#else
+	if (m_data)
+		munmap(const_cast<char*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_header = nullptr;
+	m_size = 0;
+}
+
+// maps the file into memory and validates it, returns false if it is not a valid instance file
+bool InstanceFile::open(const std::string& path)
+{
+	unmap();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Cannot open instance file " << path << std::endl;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(m_fileHandle, &fileSize);
+	m_size = static_cast<std::size_t>(fileSize.QuadPart);
+	if (m_size > 0)
+	{
+		m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mappingHandle)
+			m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		std::cout << "Cannot open instance file " << path << std::endl;
+		return false;
+	}
+	struct stat fileStat;
+	fstat(fd, &fileStat);
+	m_size = static_cast<std::size_t>(fileStat.st_size);
+	if (m_size > 0)
+	{
+		void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+			m_data = static_cast<const char*>(mapping);
+	}
+	::close(fd); // the mapping stays valid
+#endif
+
+	if (!m_data)
+	{
+		std::cout << "Cannot map instance file " << path << std::endl;
+		unmap();
+		return false;
+	}
+
+	// validating the header and the size of the arrays
+	m_header = reinterpret_cast<const InstanceFileHeader*>(m_data);
+	if (m_size < sizeof(InstanceFileHeader) || std::memcmp(m_header->magic, "VMAI", 4) != 0)
+	{
+		std::cout << "Invalid instance file " << path << std::endl;
+		unmap();
+		return false;
+	}
+	if (m_header->version != INSTANCE_FILE_VERSION)
+	{
+		std::cout << "Unsupported instance file version " << m_header->version << " in " << path << std::endl;
+		unmap();
+		return false;
+	}
+	uint64_t numValues = (uint64_t)m_header->numVMs * m_header->dimension + m_header->numVMs + (uint64_t)m_header->numPMs * m_header->dimension;
+	if (m_header->flags & INSTANCE_FILE_CLUSTERS)
+		numValues += m_header->numPMs;
+	if (m_size != sizeof(InstanceFileHeader) + numValues * sizeof(int32_t))
+	{
+		std::cout << "Truncated instance file " << path << std::endl;
+		unmap();
+		return false;
+	}
+	if (checksum(m_data + sizeof(InstanceFileHeader), m_size - sizeof(InstanceFileHeader)) != m_header->checksum)
+	{
+		std::cout << "Checksum mismatch in instance file " << path << std::endl;
+		unmap();
+		return false;
+	}
+
+	return true;
+}
+
+int InstanceFile::getNumVMs()
+{
+	return m_header->numVMs;
+}
+
+int InstanceFile::getNumPMs()
+{
+	return m_header->numPMs;
+}
+
+int InstanceFile::getDimension()
+{
+	return m_header->dimension;
+}
+
+const int32_t* InstanceFile::getDemands()
+{
+	return reinterpret_cast<const int32_t*>(m_data + sizeof(InstanceFileHeader));
+}
+
+const int32_t* InstanceFile::getInitialIDs()
+{
+	return getDemands() + (std::size_t)m_header->numVMs * m_header->dimension;
+}
+
+const int32_t* InstanceFile::getCapacities()
+{
+	return getInitialIDs() + m_header->numVMs;
+}
+
+const int32_t* InstanceFile::getClusters()
+{
+	if (!(m_header->flags & INSTANCE_FILE_CLUSTERS))
+		return nullptr;
+	return getCapacities() + (std::size_t)m_header->numPMs * m_header->dimension;
+}
+
+// copies the mapped arrays into an instance (transposing them to dimension-major order)
+// returns nullptr if a value cannot be stored as a resource value
+ProblemInstancePtr InstanceFile::toInstance()
+{
+	int numVMs = getNumVMs();
+	int numPMs = getNumPMs();
+	int dimension = getDimension();
+	auto instance = std::make_shared<ProblemInstance>(dimension, numVMs, numPMs);
+
+	const int32_t* demands = getDemands();
+	const int32_t* capacities = getCapacities();
+	bool valid = true;
+	for (int i = 0; i < numVMs; i++)
+	{
+		for (int d = 0; d < dimension; d++)
+			valid &= instance->setDemand(i, d, demands[(std::size_t)i * dimension + d]);
+	}
+	instance->initialIDs.assign(getInitialIDs(), getInitialIDs() + numVMs);
+	for (int i = 0; i < numPMs; i++)
+	{
+		for (int d = 0; d < dimension; d++)
+			valid &= instance->setCapacity(i, d, capacities[(std::size_t)i * dimension + d]);
+	}
+	if (getClusters())
+		instance->PMClusters.assign(getClusters(), getClusters() + numPMs);
+
+	if (!valid)
+	{
+		std::cout << "Instance file contains resource values which cannot be stored" << std::endl;
+		return nullptr;
+	}
+	return instance;
+}
+
+// 64 bit FNV-1a hash
+uint64_t InstanceFile::checksum(const char* data, std::size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// writes the instance as a binary instance file
+bool InstanceFile::write(const std::string& path, const ProblemInstance& instance)
+{
+	InstanceFileHeader header;
+	std::memcpy(header.magic, "VMAI", 4);
+	header.version = INSTANCE_FILE_VERSION;
+	header.numVMs = instance.numVMs;
+	header.numPMs = instance.numPMs;
+	header.dimension = instance.dimension;
+	header.flags = instance.PMClusters.empty() ? 0 : INSTANCE_FILE_CLUSTERS;
+
+	std::vector<int32_t> values;
+	values.reserve((header.numVMs + header.numPMs) * header.dimension + header.numVMs + instance.PMClusters.size());
+	for (int i = 0; i < instance.numVMs; i++)
+	{
+		for (int d = 0; d < instance.dimension; d++)
+			values.push_back(instance.demand(i, d));
+	}
+	values.insert(values.end(), instance.initialIDs.begin(), instance.initialIDs.end());
+	for (int i = 0; i < instance.numPMs; i++)
+	{
+		for (int d = 0; d < instance.dimension; d++)
+			values.push_back(instance.capacity(i, d));
+	}
+	values.insert(values.end(), instance.PMClusters.begin(), instance.PMClusters.end());
+
+	const char* data = values.empty() ? "" : reinterpret_cast<const char*>(&values[0]);
+	std::size_t size = values.size() * sizeof(int32_t);
+	header.checksum = checksum(data, size);
+
+	BufferedWriter file(path);
+	if (!file.good())
+	{
+		std::cout << "Cannot create instance file " << path << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(data, size);
+	file.close();
+	return true;
+}
+
+// converts an instance in the text format of ProblemGenerator::testFromFile() to a binary instance file
+bool InstanceFile::convertFromText(const std::string& textPath, const std::string& binaryPath, int dimension)
+{
+	std::ifstream fileIn(textPath.c_str());
+	if (!fileIn.good())
+	{
+		std::cout << "Cannot open text instance " << textPath << std::endl;
+		return false;
+	}
+
+	int nVMs;
+	int nPMs;
+	fileIn >> nVMs >> nPMs;
+	if (fileIn.fail() || nVMs < 0 || nPMs < 0)
+	{
+		std::cout << "Invalid text instance " << textPath << std::endl;
+		return false;
+	}
+
+	ProblemInstance instance(dimension, nVMs, nPMs);
+	int value;
+	bool valid = true;
+
+	for (int i = 0; i < nVMs; i++)
+	{
+		for (int j = 0; j < dimension; j++)
+		{
+			fileIn >> value;
+			valid &= instance.setDemand(i, j, value);
+		}
+		fileIn >> instance.initialIDs[i];
+	}
+
+	for (int i = 0; i < nPMs; i++)
+	{
+		for (int j = 0; j < dimension; j++)
+		{
+			fileIn >> value;
+			valid &= instance.setCapacity(i, j, value);
+		}
+	}
+
+	if (fileIn.fail() || !valid)
+	{
+		std::cout << "Invalid text instance " << textPath << std::endl;
+		return false;
+	}
+
+	return write(binaryPath, instance);
+}
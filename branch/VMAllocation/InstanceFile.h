@@ -0,0 +1,82 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTANCEFILE_H
+#define INSTANCEFILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "ProblemInstance.h"
+
+#define INSTANCE_FILE_VERSION 1
+#define INSTANCE_FILE_CLUSTERS 1 // flag: the capacities are followed by the PM clusters
+
+// header of a binary instance file
+// the header is followed by the contiguous arrays (little endian 32 bit integers):
+// demand[numVMs][dimension], initialID[numVMs], capacity[numPMs][dimension], cluster[numPMs] (only with INSTANCE_FILE_CLUSTERS)
+struct InstanceFileHeader
+{
+	char magic[4]; // "VMAI"
+	uint32_t version;
+	uint32_t numVMs;
+	uint32_t numPMs;
+	uint32_t dimension;
+	uint32_t flags;
+	uint64_t checksum; // FNV-1a hash of the arrays
+};
+
+// read-only, memory mapped view of a binary instance file
+class InstanceFile
+{
+	const char* m_data; // start of the mapping
+	std::size_t m_size; // size of the mapping in bytes
+	const InstanceFileHeader* m_header;
+
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	void unmap();
+
+public:
+	InstanceFile();
+	~InstanceFile();
+	InstanceFile(const InstanceFile&) = delete;
+	InstanceFile& operator=(const InstanceFile&) = delete;
+
+	bool open(const std::string& path);
+
+	int getNumVMs();
+	int getNumPMs();
+	int getDimension();
+	const int32_t* getDemands(); // numVMs * dimension values, VM after VM
+	const int32_t* getInitialIDs();
+	const int32_t* getCapacities(); // numPMs * dimension values, PM after PM
+	const int32_t* getClusters(); // nullptr if the PMs are not clustered
+
+	ProblemInstancePtr toInstance();
+
+	static uint64_t checksum(const char* data, std::size_t size);
+	static bool write(const std::string& path, const ProblemInstance& instance);
+	static bool convertFromText(const std::string& textPath, const std::string& binaryPath, int dimension);
+};
+
+#endif
@@ -0,0 +1,469 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <map>
+
+#include "LNSAllocator.h"
+#include "BnBAllocator.h"
+#include "ThreadPool.h"
+
+LNSAllocator::LNSAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l)
+	:m_instance(instance), m_problem(instance), m_costModel(*instance, *pa), m_log(l), m_weights(NUM_NEIGHBOURHOOD_TYPES, 1.0), m_random(1), m_numNodes(0), m_bestCost(-1), m_activeHosts(-1), m_migrations(-1)
+{
+	std::shared_ptr<LNSParams> params = std::dynamic_pointer_cast<LNSParams>(pa);
+
+	if (!params)
+		std::cout << "Error: invalid parameters type for LNSAllocator." << std::endl;
+
+	m_params = *params;
+
+	m_numMaxMigrations = instance->numPMs / m_params.maxMigrationsRatio;
+
+	// PMs with the same capacities form a class
+	m_PMClass = instance->capacityClasses(m_numPMClasses);
+}
+
+bool LNSAllocator::fits(const std::vector<long long>& free, int vm, int pm)
+{
+	for (int d = 0; d < m_instance->dimension; d++)
+	{
+		if (free[(std::size_t)d * m_instance->numPMs + pm] < m_instance->demand(vm, d))
+			return false;
+	}
+	return true;
+}
+
+// returns true if every VM is on a PM of its cluster, the capacities and the migration limit are kept
+bool LNSAllocator::isValidPlacement(const std::vector<int>& placement)
+{
+	const ProblemInstance& instance = *m_instance;
+	if ((int)placement.size() != instance.numVMs)
+		return false;
+
+	std::vector<long long> free(instance.capacities.begin(), instance.capacities.end());
+	int numMigrations = 0;
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		int pm = placement[vm];
+		if (pm < 0 || pm >= instance.numPMs || !instance.inCluster(vm, pm))
+			return false;
+		for (int d = 0; d < instance.dimension; d++)
+		{
+			free[(std::size_t)d * instance.numPMs + pm] -= instance.demand(vm, d);
+			if (free[(std::size_t)d * instance.numPMs + pm] < 0)
+				return false;
+		}
+		if (instance.initialIDs[vm] >= 0 && instance.initialIDs[vm] != pm)
+			numMigrations++;
+	}
+
+	return numMigrations <= m_numMaxMigrations;
+}
+
+double LNSAllocator::placementCost(const std::vector<int>& placement, int& numPMsOn, int& numMigrations)
+{
+	std::vector<bool> on(m_instance->numPMs, false);
+	numPMsOn = 0;
+	numMigrations = 0;
+	for (int vm = 0; vm < m_instance->numVMs; vm++)
+	{
+		if (!on[placement[vm]])
+		{
+			on[placement[vm]] = true;
+			numPMsOn++;
+		}
+		if (m_instance->initialIDs[vm] >= 0 && m_instance->initialIDs[vm] != placement[vm])
+			numMigrations++;
+	}
+
+	return m_costModel.cost(*m_instance, placement);
+}
+
+// starting allocation: the initial one if it is valid, else first fit (initial PM first, then PMs already on, then the others)
+bool LNSAllocator::createStartPlacement()
+{
+	const ProblemInstance& instance = *m_instance;
+	if (isValidPlacement(instance.initialIDs))
+	{
+		m_placement = instance.initialIDs;
+		return true;
+	}
+
+	std::vector<int> placement(instance.numVMs, -1);
+	std::vector<long long> free(instance.capacities.begin(), instance.capacities.end());
+	std::vector<bool> on(instance.numPMs, false);
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		int initial = instance.initialIDs[vm];
+		if (initial >= 0 && fits(free, vm, initial))
+		{
+			placement[vm] = initial;
+		}
+		for (int pass = 0; pass < 2 && placement[vm] < 0; pass++) // first pass: PMs already on
+		{
+			for (int pm = 0; pm < instance.numPMs; pm++)
+			{
+				if (on[pm] == (pass == 0) && instance.inCluster(vm, pm) && fits(free, vm, pm))
+				{
+					placement[vm] = pm;
+					break;
+				}
+			}
+		}
+		if (placement[vm] < 0)
+			return false;
+
+		for (int d = 0; d < instance.dimension; d++)
+			free[(std::size_t)d * instance.numPMs + placement[vm]] -= instance.demand(vm, d);
+		on[placement[vm]] = true;
+	}
+
+	if (!isValidPlacement(placement))
+		return false;
+	m_placement = placement;
+	return true;
+}
+
+void LNSAllocator::updateVMsOnPM()
+{
+	m_VMsOnPM.assign(m_instance->numPMs, std::vector<int>());
+	for (int vm = 0; vm < m_instance->numVMs; vm++)
+		m_VMsOnPM[m_placement[vm]].push_back(vm);
+}
+
+// roulette wheel selection according to the adaptive weights
+LNSAllocator::NeighbourhoodType LNSAllocator::chooseNeighbourhoodType()
+{
+	double sum = 0;
+	for (double weight : m_weights)
+		sum += weight;
+
+	double r = std::uniform_real_distribution<double>(0, sum)(m_random);
+	for (int type = 0; type < NUM_NEIGHBOURHOOD_TYPES; type++)
+	{
+		r -= m_weights[type];
+		if (r <= 0)
+			return (NeighbourhoodType)type;
+	}
+	return (NeighbourhoodType)(NUM_NEIGHBOURHOOD_TYPES - 1);
+}
+
+// chooses PMs not used by the other neighbourhoods of the same round, returns false if there are no PMs left
+// the PMs of a neighbourhood are in one cluster, so the subproblem can not move a VM out of its cluster
+bool LNSAllocator::selectNeighbourhood(NeighbourhoodType type, std::vector<bool>& usedPMs, Neighbourhood& neighbourhood)
+{
+	const ProblemInstance& instance = *m_instance;
+	int size = std::max(1, m_params.neighbourhoodSize);
+
+	std::vector<int> candidates; // PMs which are on and not used yet
+	for (int pm = 0; pm < instance.numPMs; pm++)
+	{
+		if (!usedPMs[pm] && !m_VMsOnPM[pm].empty())
+			candidates.push_back(pm);
+	}
+	if (candidates.empty())
+		return false;
+
+	std::shuffle(candidates.begin(), candidates.end(), m_random);
+	if (type == LOW_UTILIZATION)
+	{
+		// the lowest utilized PMs, randomized among the twice as many lowest ones
+		std::vector<double> utilization(instance.numPMs, 0);
+		for (int pm : candidates)
+		{
+			for (int vm : m_VMsOnPM[pm])
+			{
+				for (int d = 0; d < instance.dimension; d++)
+					utilization[pm] += (double)instance.demand(vm, d) / std::max(1, (int)instance.capacity(pm, d));
+			}
+		}
+		std::size_t count = std::min(candidates.size(), (std::size_t)size * 2);
+		std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [&](int pm1, int pm2)
+		{
+			return utilization[pm1] < utilization[pm2];
+		});
+		candidates.resize(count);
+		std::shuffle(candidates.begin(), candidates.end(), m_random);
+	}
+	else if (type == PM_CLASS)
+	{
+		// PMs of the class of a random candidate
+		int pmClass = m_PMClass[candidates[0]];
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int pm) {return m_PMClass[pm] != pmClass; }), candidates.end());
+	}
+	int cluster = instance.PMClusters.empty() ? 0 : instance.PMClusters[candidates[0]];
+	auto otherCluster = [&](int pm) {return !instance.PMClusters.empty() && instance.PMClusters[pm] != cluster; };
+	candidates.erase(std::remove_if(candidates.begin(), candidates.end(), otherCluster), candidates.end());
+
+	if ((int)candidates.size() > size)
+		candidates.resize(size);
+	neighbourhood.type = type;
+	neighbourhood.PMs = candidates;
+	for (int pm : candidates)
+		usedPMs[pm] = true;
+
+	// empty PMs which can be turned on: at most one of each class
+	std::vector<int> emptyPMs;
+	for (int pm = 0; pm < instance.numPMs; pm++)
+	{
+		if (!usedPMs[pm] && m_VMsOnPM[pm].empty() && !otherCluster(pm))
+			emptyPMs.push_back(pm);
+	}
+	std::shuffle(emptyPMs.begin(), emptyPMs.end(), m_random);
+	std::vector<bool> classUsed(m_numPMClasses, false);
+	neighbourhood.targets.clear();
+	for (int pm : emptyPMs)
+	{
+		if ((int)neighbourhood.targets.size() >= std::max(1, size / 2))
+			break;
+		if (classUsed[m_PMClass[pm]])
+			continue;
+		classUsed[m_PMClass[pm]] = true;
+		neighbourhood.targets.push_back(pm);
+		usedPMs[pm] = true;
+	}
+
+	return true;
+}
+
+// re-allocates the VMs of the neighbourhood with a BnBAllocator on the extracted subproblem
+// only reads the current allocation, so disjoint neighbourhoods can be solved in parallel
+void LNSAllocator::solveNeighbourhood(const Neighbourhood& neighbourhood, double timeout, SubResult& result)
+{
+	const ProblemInstance& instance = *m_instance;
+	result.VMs.clear();
+	result.placement.clear();
+	result.nodes = 0;
+
+	std::vector<int> PMs(neighbourhood.PMs);
+	PMs.insert(PMs.end(), neighbourhood.targets.begin(), neighbourhood.targets.end());
+	std::map<int, int> subIndexOf;
+	for (std::size_t i = 0; i < PMs.size(); i++)
+		subIndexOf[PMs[i]] = i;
+	for (int pm : neighbourhood.PMs)
+		result.VMs.insert(result.VMs.end(), m_VMsOnPM[pm].begin(), m_VMsOnPM[pm].end());
+
+	// subproblem: the VMs keep their initial PM if it is in the neighbourhood, else they are migrated anyway
+	int numVMs = result.VMs.size();
+	auto subInstance = std::make_shared<const ProblemInstance>(instance.subInstance(result.VMs, PMs));
+	int currentMigrations = 0; // migrations of the current allocation counted by the subproblem
+	for (int i = 0; i < numVMs; i++)
+	{
+		if (subInstance->initialIDs[i] >= 0 && instance.initialIDs[result.VMs[i]] != m_placement[result.VMs[i]])
+			currentMigrations++;
+	}
+
+	auto subParams = std::make_shared<BnBParams>(m_params);
+	subParams->timeout = timeout;
+	std::ostream noLog(nullptr); // the sub-solvers are not logged (and they may run in parallel)
+	BnBAllocator subSolver(subInstance, subParams, noLog);
+	subSolver.setMaxMigrations(currentMigrations + neighbourhood.migrationBudget);
+
+	AllocationProblem incumbentState(subInstance);
+	AllocationMapType incumbent;
+	std::vector<int> incumbentPlacement(numVMs);
+	for (int i = 0; i < numVMs; i++)
+	{
+		incumbentPlacement[i] = subIndexOf[m_placement[result.VMs[i]]];
+		incumbent[&incumbentState.VMs[i]] = &incumbentState.PMs[incumbentPlacement[i]];
+	}
+	double incumbentCost = CostModel(*subInstance, m_params).cost(*subInstance, incumbentPlacement);
+	subSolver.setIncumbent(incumbent);
+	subSolver.solve();
+	result.nodes = subSolver.getNodeCount();
+
+	double cost = subSolver.getBestCost();
+	if (cost < 0 || cost >= incumbentCost)
+		return;
+
+	result.placement.resize(numVMs);
+	for (const auto& iter : subSolver.getBestAllocation())
+		result.placement[iter.first->id] = PMs[iter.second->id];
+}
+
+// solves the allocation problem and stores the results in member variables
+void LNSAllocator::solve()
+{
+	m_timer.start();
+
+	if (m_placement.empty() && !createStartPlacement())
+	{
+		#ifdef VERBOSE_BASIC
+			m_log << "LNS: no starting allocation found." << std::endl;
+		#endif
+		return;
+	}
+
+	int numPMsOn;
+	int numMigrations;
+	m_bestCost = placementCost(m_placement, numPMsOn, numMigrations);
+	int numThreads = std::max(1, m_params.numThreads);
+	int numNeighbourhoods = 0;
+	int numImprovements = 0;
+	int numRejected = 0;
+	ThreadPool pool(numThreads);
+
+	while (m_timer.getElapsedTime() < m_params.timeout)
+	{
+		updateVMsOnPM();
+
+		// disjoint neighbourhoods of this round, each of them may use all the remaining migrations
+		std::vector<bool> usedPMs(m_instance->numPMs, false);
+		std::vector<Neighbourhood> neighbourhoods;
+		for (int i = 0; i < numThreads; i++)
+		{
+			Neighbourhood neighbourhood;
+			if (!selectNeighbourhood(chooseNeighbourhoodType(), usedPMs, neighbourhood))
+				break;
+			neighbourhoods.push_back(neighbourhood);
+		}
+		if (neighbourhoods.empty())
+			break;
+		for (auto& neighbourhood : neighbourhoods)
+			neighbourhood.migrationBudget = m_numMaxMigrations - numMigrations;
+
+		double timeout = std::min(m_params.subTimeout, m_params.timeout - m_timer.getElapsedTime());
+		std::vector<SubResult> results(neighbourhoods.size());
+		if (neighbourhoods.size() == 1)
+		{
+			solveNeighbourhood(neighbourhoods[0], timeout, results[0]);
+		}
+		else
+		{
+			for (std::size_t i = 0; i < neighbourhoods.size(); i++)
+				pool.submit([this, &neighbourhoods, &results, i, timeout] {solveNeighbourhood(neighbourhoods[i], timeout, results[i]); });
+			pool.wait();
+		}
+
+		// accepting the improvements in order while the migrations stay within the limit, and adapting the weights of the neighbourhood types
+		// a rejected improvement does not change the weight, its neighbourhood can be selected again in a later round
+		for (std::size_t i = 0; i < neighbourhoods.size(); i++)
+		{
+			const SubResult& result = results[i];
+			bool improved = !result.placement.empty();
+			m_numNodes += result.nodes;
+			numNeighbourhoods++;
+			if (improved)
+			{
+				int extraMigrations = 0;
+				for (std::size_t j = 0; j < result.placement.size(); j++)
+				{
+					int initial = m_instance->initialIDs[result.VMs[j]];
+					if (initial >= 0)
+						extraMigrations += (initial != result.placement[j]) - (initial != m_placement[result.VMs[j]]);
+				}
+				if (numMigrations + extraMigrations > m_numMaxMigrations)
+				{
+					numRejected++;
+					continue;
+				}
+				numMigrations += extraMigrations;
+				for (std::size_t j = 0; j < result.placement.size(); j++)
+					m_placement[result.VMs[j]] = result.placement[j];
+				numImprovements++;
+			}
+
+			double& weight = m_weights[neighbourhoods[i].type];
+			weight = std::max(0.05, 0.8 * weight + 0.2 * (improved ? 1.0 : 0.0));
+		}
+
+		double cost = placementCost(m_placement, numPMsOn, numMigrations);
+		#ifdef VERBOSE_COST_CHANGE
+			if (cost < m_bestCost)
+				m_log << m_timer.getElapsedTime() << ", " << cost << std::endl;
+		#endif
+		m_bestCost = cost;
+	}
+
+	assert(isValidPlacement(m_placement));
+	storeBestAllocation();
+	m_activeHosts = numPMsOn;
+	m_migrations = numMigrations;
+
+	#ifdef VERBOSE_BASIC
+		m_log << "LNS: " << numNeighbourhoods << " neighbourhoods solved, " << numImprovements << " improvements (" << numRejected << " rejected for the migration limit), weights:";
+		for (double weight : m_weights)
+			m_log << " " << weight;
+		m_log << std::endl;
+	#endif
+}
+
+void LNSAllocator::storeBestAllocation()
+{
+	m_bestAllocation.clear();
+	for (int vm = 0; vm < m_instance->numVMs; vm++)
+		m_bestAllocation[&m_problem.VMs[vm]] = &m_problem.PMs[m_placement[vm]];
+}
+
+// returns the cost of the best allocation found, or -1 when no allocation was found
+double LNSAllocator::getBestCost()
+{
+	#ifdef VERBOSE_BASIC
+		m_log << "alloc:\t";
+		for (int vm = 0; vm < (int)m_placement.size(); vm++)
+			m_log << vm << "->" << m_placement[vm] << " ";
+		m_log << std::endl;
+	#endif
+
+	return (m_bestAllocation.empty()) ? -1 : m_bestCost;
+}
+
+const AllocationMapType& LNSAllocator::getBestAllocation()
+{
+	return m_bestAllocation;
+}
+
+int LNSAllocator::getActiveHosts()
+{
+	return m_activeHosts;
+}
+
+int LNSAllocator::getMigrations()
+{
+	return m_migrations;
+}
+
+long long LNSAllocator::getNodeCount()
+{
+	return m_numNodes;
+}
+
+// starts the search from a known allocation (VMs and PMs are matched by id)
+// must be called before the start of the algorithm
+void LNSAllocator::setIncumbent(const AllocationMapType& allocation)
+{
+	std::vector<int> placement(m_instance->numVMs, -1);
+	for (const auto& iter : allocation)
+	{
+		if (iter.first->id < m_instance->numVMs)
+			placement[iter.first->id] = iter.second->id;
+	}
+
+	if (!isValidPlacement(placement))
+	{
+		m_log << "WARNING: incumbent is not a valid allocation, it is ignored." << std::endl;
+		return;
+	}
+	m_placement = placement;
+}
@@ -0,0 +1,104 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LNSALLOCATOR_H
+#define LNSALLOCATOR_H
+
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <random>
+
+#include "VMAllocator.h"
+#include "AllocationProblem.h"
+#include "LNSParams.h"
+#include "Timer.h"
+
+// large neighbourhood search: starting from the initial allocation (or a first fit one), a few PMs are freed repeatedly,
+// and their VMs are re-allocated by a time-boxed BnBAllocator, while every other VM stays where it is
+// the freed PMs and some empty target PMs form a standalone subproblem, so the sub-solver only sees the neighbourhood
+class LNSAllocator : public VMAllocator
+{
+	enum NeighbourhoodType
+	{
+		LOW_UTILIZATION, // PMs with the lowest utilization
+		PM_CLASS, // PMs of one capacity class
+		RANDOM_PMS, // random PMs
+		NUM_NEIGHBOURHOOD_TYPES
+	};
+
+	struct Neighbourhood
+	{
+		NeighbourhoodType type;
+		std::vector<int> PMs; // freed PMs, all of their VMs are re-allocated
+		std::vector<int> targets; // empty PMs which can be turned on
+		int migrationBudget; // migrations the neighbourhood may use on top of its current ones (all the remaining ones)
+	};
+
+	struct SubResult
+	{
+		std::vector<int> VMs; // re-allocated VMs
+		std::vector<int> placement; // their new PMs (empty if there was no improvement)
+		long long nodes;
+	};
+
+	ProblemInstancePtr m_instance;
+	AllocationProblem m_problem; // VM and PM objects of the returned allocation
+	LNSParams m_params; // algorithm parameters
+	CostModel m_costModel;
+	std::ostream& m_log; // output log
+	Timer m_timer;
+
+	int m_numMaxMigrations;
+	std::vector<int> m_placement; // current allocation: for each VM the index of its PM (empty if there is none)
+	std::vector<std::vector<int>> m_VMsOnPM; // VMs of each PM in the current allocation
+	std::vector<int> m_PMClass; // capacity class of each PM (PMs with the same capacities are in the same class)
+	int m_numPMClasses;
+	std::vector<double> m_weights; // adaptive weight of each neighbourhood type
+	std::mt19937 m_random;
+	long long m_numNodes;
+	double m_bestCost;
+
+	AllocationMapType m_bestAllocation;
+	int m_activeHosts;
+	int m_migrations;
+
+	bool fits(const std::vector<long long>& free, int vm, int pm);
+	bool createStartPlacement();
+	bool isValidPlacement(const std::vector<int>& placement);
+	double placementCost(const std::vector<int>& placement, int& numPMsOn, int& numMigrations);
+	void updateVMsOnPM();
+	NeighbourhoodType chooseNeighbourhoodType();
+	bool selectNeighbourhood(NeighbourhoodType type, std::vector<bool>& usedPMs, Neighbourhood& neighbourhood);
+	void solveNeighbourhood(const Neighbourhood& neighbourhood, double timeout, SubResult& result);
+	void storeBestAllocation();
+
+public:
+	LNSAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l);
+	void solve() final override;
+	double getBestCost() final override;
+	const AllocationMapType& getBestAllocation() final override;
+	int getActiveHosts() final override;
+	int getMigrations() final override;
+	long long getNodeCount() final override;
+	void setIncumbent(const AllocationMapType& allocation) final override;
+};
+
+#endif
@@ -0,0 +1,34 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LNSPARAMS_H
+#define LNSPARAMS_H
+
+#include "BnBParams.h"
+
+// the BnB parameters are used by the sub-solver of the neighbourhoods
+struct LNSParams : public BnBParams
+{
+	double subTimeout; // timeout of one neighbourhood in seconds
+	int neighbourhoodSize; // number of PMs freed in one neighbourhood
+	int numThreads; // number of disjoint neighbourhoods solved in parallel
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+
+#include "LogSink.h"
+
+LogSink::LogSink(const std::string& path)
+	:m_tail(&m_stub), m_file(path), m_stopping(false)
+{
+	m_stub.next.store(nullptr);
+	m_head.store(&m_stub);
+	m_writer = std::thread(&LogSink::run, this);
+}
+
+// writes out every record still in the queue, then closes the file
+LogSink::~LogSink()
+{
+	m_stopping.store(true);
+	m_writer.join();
+	m_file.close();
+}
+
+bool LogSink::good()
+{
+	return m_file.good();
+}
+
+void LogSink::push(Record* record)
+{
+	record->next.store(nullptr, std::memory_order_relaxed);
+	Record* previous = m_head.exchange(record, std::memory_order_acq_rel);
+	previous->next.store(record, std::memory_order_release);
+}
+
+// returns the next record, or nullptr if the queue is empty (or a push is still in progress)
+LogSink::Record* LogSink::pop()
+{
+	Record* tail = m_tail;
+	Record* next = tail->next.load(std::memory_order_acquire);
+
+	if (tail == &m_stub)
+	{
+		if (next == nullptr)
+			return nullptr;
+		m_tail = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if (next != nullptr)
+	{
+		m_tail = next;
+		return tail;
+	}
+
+	if (tail != m_head.load(std::memory_order_acquire))
+		return nullptr;
+
+	// tail is the last record, the stub is pushed behind it so that it can be popped
+	push(&m_stub);
+	next = tail->next.load(std::memory_order_acquire);
+	if (next != nullptr)
+	{
+		m_tail = next;
+		return tail;
+	}
+
+	return nullptr;
+}
+
+// background thread: formats and writes the records
+void LogSink::run()
+{
+	while (true)
+	{
+		Record* record = pop();
+		if (record == nullptr)
+		{
+			if (m_stopping.load())
+			{
+				// producers are finished before the sink is destroyed, one more pass empties the queue
+				while ((record = pop()) != nullptr)
+				{
+					m_file << record->text;
+					if (record->instance)
+						writeInstance(record->instanceId, *record->instance);
+					delete record;
+				}
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		m_file << record->text;
+		if (record->instance)
+			writeInstance(record->instanceId, *record->instance);
+		delete record;
+	}
+}
+
+void LogSink::writeInstance(int id, const ProblemInstance& instance)
+{
+	int dimension = instance.dimension;
+
+	m_file << "Instance " << id << " (" << instance.numVMs << " VMs, " << instance.numPMs << " PMs):\n";
+	m_file << "\nPMs:\t";
+	for (int pm = 0; pm < instance.numPMs; pm++)
+	{
+		m_file << '[';
+		for (int i = 0; i < dimension; i++)
+		{
+			m_file << instance.capacity(pm, i);
+			if (i != dimension - 1)
+				m_file << ' ';
+		}
+		m_file << "] ";
+	}
+	m_file << "\nVMs:\t";
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		m_file << '[';
+		for (int i = 0; i < dimension; i++)
+		{
+			m_file << instance.demand(vm, i);
+			if (i != dimension - 1)
+				m_file << ' ';
+		}
+		m_file << "] ";
+	}
+	m_file << "\ninit:\t";
+	for (int vm = 0; vm < instance.numVMs; vm++)
+	{
+		m_file << vm << "->" << instance.initialIDs[vm] << ' ';
+	}
+	m_file << "\n\n";
+}
+
+void LogSink::write(std::string&& text)
+{
+	Record* record = new Record;
+	record->text = std::move(text);
+	record->instanceId = -1;
+	push(record);
+}
+
+// the instance is formatted by the background thread
+void LogSink::writeInstance(std::string&& text, int id, ProblemInstancePtr instance)
+{
+	Record* record = new Record;
+	record->text = std::move(text);
+	record->instanceId = id;
+	record->instance = instance;
+	push(record);
+}
+
+LogStream::Buffer::Buffer(LogSink& sink)
+	:m_sink(sink)
+{
+
+}
+
+LogStream::Buffer::int_type LogStream::Buffer::overflow(int_type c)
+{
+	if (c != traits_type::eof())
+		m_pending.push_back(traits_type::to_char_type(c));
+	return traits_type::not_eof(c);
+}
+
+std::streamsize LogStream::Buffer::xsputn(const char* s, std::streamsize count)
+{
+	m_pending.append(s, static_cast<std::size_t>(count));
+	return count;
+}
+
+// called on std::endl and flush(), only hands the text over when a whole chunk is collected
+int LogStream::Buffer::sync()
+{
+	if (m_pending.size() >= LOG_CHUNK_SIZE)
+		handOver();
+	return 0;
+}
+
+void LogStream::Buffer::handOver()
+{
+	if (m_pending.empty())
+		return;
+	std::string chunk;
+	chunk.reserve(LOG_CHUNK_SIZE + 256);
+	chunk.swap(m_pending);
+	m_sink.write(std::move(chunk));
+}
+
+void LogStream::Buffer::handOverWithInstance(int id, ProblemInstancePtr instance)
+{
+	std::string chunk;
+	chunk.reserve(LOG_CHUNK_SIZE + 256);
+	chunk.swap(m_pending);
+	m_sink.writeInstance(std::move(chunk), id, instance);
+}
+
+LogStream::LogStream(LogSink& sink)
+	:std::ostream(nullptr), m_buffer(sink)
+{
+	rdbuf(&m_buffer);
+}
+
+LogStream::~LogStream()
+{
+	m_buffer.handOver();
+}
+
+void LogStream::logInstance(int id, ProblemInstancePtr instance)
+{
+	m_buffer.handOverWithInstance(id, instance);
+}
@@ -0,0 +1,101 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "ProblemInstance.h"
+#include "BufferedWriter.h"
+
+#define LOG_CHUNK_SIZE (64 * 1024) // text is handed over to the background thread in chunks of this size
+
+// log file written by a background thread
+// producers hand over records through a lock-free queue, the file is only flushed when its buffer is full or at the end
+class LogSink
+{
+	struct Record
+	{
+		std::atomic<Record*> next;
+		std::string text;
+		int instanceId; // instance to dump after the text, -1 if none
+		ProblemInstancePtr instance;
+	};
+
+	// intrusive multiple producer, single consumer queue
+	std::atomic<Record*> m_head; // last pushed record
+	Record* m_tail; // next record to pop (only used by the background thread)
+	Record m_stub;
+
+	BufferedWriter m_file;
+	std::atomic<bool> m_stopping;
+	std::thread m_writer;
+
+	void push(Record* record);
+	Record* pop();
+	void run();
+	void writeInstance(int id, const ProblemInstance& instance);
+
+public:
+	LogSink(const std::string& path);
+	~LogSink();
+	LogSink(const LogSink&) = delete;
+	LogSink& operator=(const LogSink&) = delete;
+
+	bool good();
+	void write(std::string&& text);
+	void writeInstance(std::string&& text, int id, ProblemInstancePtr instance);
+};
+
+// output stream of a LogSink, formatted text is collected locally and handed over in large chunks
+// (std::endl does not flush to the disk, only to the sink when enough text has been collected)
+// one LogStream must only be used by one thread at a time, but several streams can share a sink
+class LogStream : public std::ostream
+{
+	class Buffer : public std::streambuf
+	{
+		LogSink& m_sink;
+		std::string m_pending;
+	protected:
+		int_type overflow(int_type c) override;
+		std::streamsize xsputn(const char* s, std::streamsize count) override;
+		int sync() override;
+	public:
+		Buffer(LogSink& sink);
+		void handOver();
+		void handOverWithInstance(int id, ProblemInstancePtr instance);
+	};
+
+	Buffer m_buffer;
+
+public:
+	LogStream(LogSink& sink);
+	~LogStream();
+
+	// dumps an instance once, later log entries can refer to it by its id
+	void logInstance(int id, ProblemInstancePtr instance);
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#endif
+
+#include "MemoryUsage.h"
+
+long long peakResidentSetSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return -1;
+	return (long long)(counters.PeakWorkingSetSize / 1024);
+#else
+	std::FILE* status = std::fopen("/proc/self/status", "r");
+	if (!status)
+		return -1;
+
+	long long peak = -1;
+	char line[256];
+	while (std::fgets(line, sizeof(line), status))
+	{
+		if (std::strncmp(line, "VmHWM:", 6) == 0)
+		{
+			std::sscanf(line + 6, "%lld", &peak);
+			break;
+		}
+	}
+	std::fclose(status);
+	return peak;
+#endif
+}
+
+void resetPeakResidentSetSize()
+{
+#ifndef _WIN32
+	std::FILE* clearRefs = std::fopen("/proc/self/clear_refs", "w");
+	if (!clearRefs)
+		return;
+	std::fputs("5", clearRefs); // resets the peak resident set size
+	std::fclose(clearRefs);
+#endif
+}
@@ -0,0 +1,30 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+// peak resident set size of the process in kilobytes (-1 if unknown)
+long long peakResidentSetSize();
+
+// starts a new peak from the current resident set size, so the next peak belongs to the following work only
+// (only supported on Linux, elsewhere the peak of the whole process is kept)
+void resetPeakResidentSetSize();
+
+#endif
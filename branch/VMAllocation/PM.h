@@ -22,25 +22,54 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 
+#include "ProblemInstance.h"
+
 struct PM
 {
-	int id;
+	int id; // index of the PM in the instance data
 	int numAdditionalVMs; // number of additional VMs allocated on this PM, if we now leave all VMs on their initial PM
-	std::vector<int> capacity;
-	std::vector<int> resourcesFree;
+	int numVMs; // number of VMs currently allocated on this PM
 
-	bool isOn();
+	bool isOn() const { return numVMs > 0; }
 	PM();
 };
 
+// read-only view of the free resources of the PMs (dimension-major matrix of the search state)
+struct FreeResources
+{
+	const ResourceValue* free; // free resources of PM i in dimension d: free[d * numPMs + i]
+	int numPMs;
+	int dimension;
+
+	ResourceValue get(const PM* pm, int d) const
+	{
+		return free[(std::size_t)d * numPMs + pm->id];
+	}
+};
+
 bool operator==(const PM& first, const PM& second);
 
 bool operator==(PM& first, PM& second);
 
-bool LexicographicPMComparator(PM* first, PM* second);
-
-bool MaximumPMComparator(PM* first, PM* second);
+// orders PMs by their cached sort keys (keyLength values per PM, compared lexicographically), ties are broken by the id
+// the key of a PM must not change while the PM is in an ordered container
+struct PMKeyComparator
+{
+	const std::vector<long long>* keys;
+	int keyLength;
+	PMKeyComparator(const std::vector<long long>* k, int length) : keys(k), keyLength(length) {}
+	bool operator()(const PM* first, const PM* second) const
+	{
+		const long long* firstKey = keys->data() + (std::size_t)first->id * keyLength;
+		const long long* secondKey = keys->data() + (std::size_t)second->id * keyLength;
+		for (int i = 0; i < keyLength; i++)
+		{
+			if (firstKey[i] != secondKey[i])
+				return firstKey[i] < secondKey[i];
+		}
 
-bool SumPMComparator(PM* first, PM* second);
+		return first->id < second->id;
+	}
+};
 
 #endif
\ No newline at end of file
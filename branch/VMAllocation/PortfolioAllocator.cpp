@@ -0,0 +1,142 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include "PortfolioAllocator.h"
+#include "ThreadPool.h"
+
+PortfolioAllocator::PortfolioAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l)
+	:m_log(l), m_incumbentCost(-1), m_bestMember(0), m_numNodes(0)
+{
+	std::shared_ptr<PortfolioParams> params = std::dynamic_pointer_cast<PortfolioParams>(pa);
+
+	if (!params)
+		std::cout << "Error: invalid parameters type for PortfolioAllocator." << std::endl;
+
+	m_params = *params;
+
+	// every member solves the problem of the portfolio
+	for (const auto& member : m_params.members)
+	{
+		auto memberParams = std::make_shared<BnBParams>(*member);
+		memberParams->timeout = m_params.timeout;
+		memberParams->maxMigrationsRatio = m_params.maxMigrationsRatio;
+		memberParams->activationCost = m_params.activationCost;
+		memberParams->migrationCost = m_params.migrationCost;
+		memberParams->activationCostDimension = m_params.activationCostDimension;
+		memberParams->migrationCostDimension = m_params.migrationCostDimension;
+		m_noLogs.push_back(std::make_unique<std::ostream>(nullptr));
+		m_members.push_back(std::make_unique<BnBAllocator>(instance, memberParams, *m_noLogs.back()));
+	}
+}
+
+// solves the allocation problem, the best allocation stays in its member
+void PortfolioAllocator::solve()
+{
+	for (auto& member : m_members)
+		member->setSharedBound(&m_sharedBound);
+
+	{
+		ThreadPool pool((int)m_members.size());
+		for (std::size_t i = 0; i < m_members.size(); i++)
+		{
+			pool.submit([this, i]
+			{
+				m_members[i]->solve();
+				if (m_members[i]->provedOptimal())
+					m_sharedBound.stop = true;
+			});
+		}
+		pool.wait();
+	}
+
+	// the other members bound with the best cost, so only the member which found it can hold an allocation of that cost
+	for (std::size_t i = 0; i < m_members.size(); i++)
+	{
+		m_costs.push_back(m_members[i]->getBestCost());
+		m_numNodes += m_members[i]->getNodeCount();
+		if (m_costs[i] >= 0 && (m_costs[m_bestMember] < 0 || m_costs[i] < m_costs[m_bestMember]))
+			m_bestMember = i;
+	}
+
+	#ifdef VERBOSE_BASIC
+		m_log << "Portfolio:" << std::endl;
+		for (std::size_t i = 0; i < m_members.size(); i++)
+			m_log << "\t" << m_params.members[i]->name << ": cost: " << m_costs[i] << ", nodes: " << m_members[i]->getNodeCount() << (m_members[i]->provedOptimal() ? ", proved optimality" : "") << std::endl;
+		m_log << "\twinner: " << getWinner() << std::endl;
+	#endif
+}
+
+// returns the cost of the best allocation found, or -1 when no allocation was found
+double PortfolioAllocator::getBestCost()
+{
+	#ifdef VERBOSE_BASIC
+		m_log << "alloc:\t";
+		std::vector<int> PMOfVM(getBestAllocation().size(), -1);
+		for (const auto& iter : getBestAllocation())
+			PMOfVM[iter.first->id] = iter.second->id;
+		for (std::size_t vm = 0; vm < PMOfVM.size(); vm++)
+			m_log << vm << "->" << PMOfVM[vm] << " ";
+		m_log << std::endl;
+	#endif
+
+	return m_costs.empty() ? -1 : m_costs[m_bestMember];
+}
+
+const AllocationMapType& PortfolioAllocator::getBestAllocation()
+{
+	return m_members.empty() ? m_noAllocation : m_members[m_bestMember]->getBestAllocation();
+}
+
+int PortfolioAllocator::getActiveHosts()
+{
+	return m_members.empty() ? -1 : m_members[m_bestMember]->getActiveHosts();
+}
+
+int PortfolioAllocator::getMigrations()
+{
+	return m_members.empty() ? -1 : m_members[m_bestMember]->getMigrations();
+}
+
+long long PortfolioAllocator::getNodeCount()
+{
+	return m_numNodes;
+}
+
+// every member starts from the incumbent
+// must be called before the start of the algorithm
+void PortfolioAllocator::setIncumbent(const AllocationMapType& allocation)
+{
+	for (auto& member : m_members)
+		member->setIncumbent(allocation);
+	if (!m_members.empty())
+		m_incumbentCost = m_members[0]->getBestCost();
+}
+
+// returns the name of the member configuration which found the best allocation ("incumbent" if none of them improved on it)
+std::string PortfolioAllocator::getWinner()
+{
+	double bestCost = m_costs.empty() ? -1 : m_costs[m_bestMember];
+	if (bestCost < 0)
+		return "";
+	if (m_incumbentCost >= 0 && bestCost >= m_incumbentCost)
+		return "incumbent";
+	return m_params.members[m_bestMember]->name;
+}
@@ -0,0 +1,62 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PORTFOLIOALLOCATOR_H
+#define PORTFOLIOALLOCATOR_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+
+#include "VMAllocator.h"
+#include "BnBAllocator.h"
+#include "PortfolioParams.h"
+#include "SharedBound.h"
+
+// races several BnB configurations on the same problem, each on its own thread
+// they bound with the best cost found by any of them, and all of them stop when one proves optimality or at the timeout
+class PortfolioAllocator : public VMAllocator
+{
+	PortfolioParams m_params; // algorithm parameters
+	std::ostream& m_log; // output log
+	std::vector<std::unique_ptr<std::ostream>> m_noLogs; // the members are not logged (they run in parallel), each one has its own null stream
+
+	std::vector<std::unique_ptr<BnBAllocator>> m_members; // in the order of the configurations
+	AllocationMapType m_noAllocation; // result of an empty portfolio
+	SharedBound m_sharedBound;
+	double m_incumbentCost; // cost of the incumbent given before the start (-1 if there is none)
+
+	std::vector<double> m_costs; // cost of the best allocation of each member after the search (-1 if none)
+	int m_bestMember; // member holding the best allocation
+	long long m_numNodes;
+
+public:
+	PortfolioAllocator(ProblemInstancePtr instance, std::shared_ptr<AllocatorParams> pa, std::ostream& l);
+	void solve() final override;
+	double getBestCost() final override;
+	const AllocationMapType& getBestAllocation() final override;
+	int getActiveHosts() final override;
+	int getMigrations() final override;
+	long long getNodeCount() final override;
+	void setIncumbent(const AllocationMapType& allocation) final override;
+	std::string getWinner() final override;
+};
+
+#endif
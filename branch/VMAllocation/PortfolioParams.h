@@ -0,0 +1,35 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PORTFOLIOPARAMS_H
+#define PORTFOLIOPARAMS_H
+
+#include <vector>
+#include <memory>
+
+#include "BnBParams.h"
+
+// the members are BnB configurations defined earlier in the config file, they all solve the problem of the portfolio:
+// the timeout, the migration limit and the cost model of the portfolio are used instead of their own
+struct PortfolioParams : public AllocatorParams
+{
+	std::vector<std::shared_ptr<BnBParams>> members; // each of them runs on its own thread
+};
+
+#endif
@@ -0,0 +1,223 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+#include "Presolve.h"
+
+Presolve::Presolve(ProblemInstancePtr instance, bool enabled)
+	:m_original(instance), m_instance(instance), m_originalPM(instance->numPMs), m_reducedPM(instance->numPMs), m_numClasses(0),
+	m_groupPrevious(instance->numVMs, -1), m_groupNext(instance->numVMs, -1), m_numGroups(0), m_maxUsefulMigrations(instance->numVMs)
+{
+	std::iota(m_originalPM.begin(), m_originalPM.end(), 0);
+	std::iota(m_reducedPM.begin(), m_reducedPM.end(), 0);
+	if (!enabled)
+		return;
+
+	const ProblemInstance& inst = *instance;
+	m_PMClass = inst.capacityClasses(m_numClasses);
+	std::vector<int> classSizes(m_numClasses, 0);
+	std::vector<int> classRepresentatives(m_numClasses);
+	for (int pm = 0; pm < inst.numPMs; pm++)
+	{
+		classSizes[m_PMClass[pm]]++;
+		classRepresentatives[m_PMClass[pm]] = pm;
+	}
+	m_interchangeable.assign(inst.numPMs, true);
+	for (int vm = 0; vm < inst.numVMs; vm++)
+	{
+		if (inst.initialIDs[vm] >= 0)
+			m_interchangeable[inst.initialIDs[vm]] = false;
+	}
+
+	// number of VMs fitting into each class, a VM can be migrated if it fits onto an other PM than its initial one
+	std::vector<int> numFittingVMs(m_numClasses, 0);
+	m_maxUsefulMigrations = 0;
+	for (int vm = 0; vm < inst.numVMs; vm++)
+	{
+		int initialClass = (inst.initialIDs[vm] >= 0) ? m_PMClass[inst.initialIDs[vm]] : -1;
+		bool movable = false;
+		for (int c = 0; c < m_numClasses; c++)
+		{
+			if (inst.fitsEmpty(vm, classRepresentatives[c]) && inst.inCluster(vm, classRepresentatives[c]))
+			{
+				numFittingVMs[c]++;
+				if (c != initialClass || classSizes[c] > 1)
+					movable = true;
+			}
+		}
+		if (initialClass >= 0 && movable)
+			m_maxUsefulMigrations++;
+	}
+
+	// at most one interchangeable PM of a class is turned on for each VM fitting into the class, the rest is dropped
+	std::vector<int> numKept(m_numClasses, 0);
+	std::vector<int> keptPMs;
+	for (int pm = 0; pm < inst.numPMs; pm++)
+	{
+		if (m_interchangeable[pm])
+		{
+			if (numKept[m_PMClass[pm]] >= numFittingVMs[m_PMClass[pm]])
+				continue;
+			numKept[m_PMClass[pm]]++;
+		}
+		keptPMs.push_back(pm);
+	}
+	if ((int)keptPMs.size() < inst.numPMs)
+	{
+		std::vector<int> VMs(inst.numVMs);
+		std::iota(VMs.begin(), VMs.end(), 0);
+		m_instance = std::make_shared<const ProblemInstance>(inst.subInstance(VMs, keptPMs));
+		m_originalPM = keptPMs;
+		m_reducedPM.assign(inst.numPMs, -1);
+		for (std::size_t i = 0; i < keptPMs.size(); i++)
+			m_reducedPM[keptPMs[i]] = i;
+	}
+
+	// groups of identical VMs, in the order of the ids
+	std::map<std::vector<int>, int> lastOfGroup; // initial PM and demands -> last VM of the group so far
+	std::vector<int> key(inst.dimension + 1);
+	for (int vm = 0; vm < inst.numVMs; vm++)
+	{
+		key[0] = inst.initialIDs[vm];
+		for (int d = 0; d < inst.dimension; d++)
+			key[d + 1] = inst.demand(vm, d);
+		auto inserted = lastOfGroup.insert(std::make_pair(key, vm));
+		if (inserted.second)
+			continue;
+
+		int previous = inserted.first->second;
+		if (m_groupPrevious[previous] < 0)
+			m_numGroups++;
+		m_groupPrevious[vm] = previous;
+		m_groupNext[previous] = vm;
+		inserted.first->second = vm;
+	}
+}
+
+// interchangeable PMs of the reduced instance which are empty and not used, for each class
+std::vector<std::vector<int>> Presolve::freeSlots(const std::vector<PM>& PMs, const std::vector<bool>& used) const
+{
+	std::vector<std::vector<int>> slots(m_numClasses);
+	for (int pm = m_instance->numPMs - 1; pm >= 0; pm--) // the slots are taken from the back
+	{
+		int original = m_originalPM[pm];
+		if (m_interchangeable[original] && PMs[pm].numVMs == 0 && !used[pm])
+			slots[m_PMClass[original]].push_back(pm);
+	}
+	return slots;
+}
+
+// the dropped PM takes the place of the PM of the reduced instance, which is dropped instead (both are empty with the same capacities)
+void Presolve::swapIn(int pm, int slot)
+{
+	m_reducedPM[m_originalPM[slot]] = -1;
+	m_originalPM[slot] = pm;
+	m_reducedPM[pm] = slot;
+}
+
+// maps a placement (for each VM the index of an original PM, or -1) to the PMs of the reduced instance
+// a dropped PM is replaced with an interchangeable PM, which is empty in the current state and not used by the placement
+// claim: the dropped PMs take the place of their replacements (else the placement only becomes an equivalent one)
+std::vector<int> Presolve::reducedPlacement(const std::vector<int>& placement, const std::vector<PM>& PMs, bool claim)
+{
+	std::vector<int> reduced(placement.size(), -1);
+	std::vector<bool> used(m_instance->numPMs, false);
+	for (int pm : placement)
+	{
+		if (pm >= 0 && m_reducedPM[pm] >= 0)
+			used[m_reducedPM[pm]] = true;
+	}
+
+	std::vector<std::vector<int>> slots;
+	std::unordered_map<int, int> replacements;
+	for (std::size_t vm = 0; vm < placement.size(); vm++)
+	{
+		int pm = placement[vm];
+		if (pm < 0)
+			continue;
+		if (m_reducedPM[pm] >= 0)
+		{
+			reduced[vm] = m_reducedPM[pm];
+			continue;
+		}
+
+		auto replacement = replacements.find(pm);
+		if (replacement == replacements.end())
+		{
+			if (slots.empty())
+				slots = freeSlots(PMs, used);
+			std::vector<int>& classSlots = slots[m_PMClass[pm]];
+			if (classSlots.empty()) // not possible if every VM fits onto its PM
+				continue;
+			replacement = replacements.insert(std::make_pair(pm, classSlots.back())).first;
+			classSlots.pop_back();
+		}
+		reduced[vm] = replacement->second;
+	}
+
+	if (claim)
+	{
+		for (const auto& replacement : replacements)
+			swapIn(replacement.first, replacement.second);
+	}
+	return reduced;
+}
+
+// maps the allowed original PMs to the PMs of the reduced instance
+// the allowed dropped PMs take the place of empty interchangeable PMs which are not allowed
+std::vector<bool> Presolve::reducedAllowedPMs(const std::vector<bool>& allowedPMs, const std::vector<PM>& PMs)
+{
+	if (droppedPMs())
+	{
+		std::vector<bool> used(m_instance->numPMs, false);
+		for (int pm = 0; pm < m_instance->numPMs; pm++)
+			used[pm] = allowedPMs[m_originalPM[pm]];
+		std::vector<std::vector<int>> slots = freeSlots(PMs, used);
+		for (int pm = 0; pm < m_original->numPMs; pm++)
+		{
+			std::vector<int>& classSlots = slots[m_PMClass[pm]];
+			if (m_reducedPM[pm] < 0 && allowedPMs[pm] && !classSlots.empty())
+			{
+				swapIn(pm, classSlots.back());
+				classSlots.pop_back();
+			}
+		}
+	}
+
+	std::vector<bool> reduced(m_instance->numPMs);
+	for (int pm = 0; pm < m_instance->numPMs; pm++)
+		reduced[pm] = allowedPMs[m_originalPM[pm]];
+	return reduced;
+}
+
+// the VM is no longer interchangeable with the others of its group (e.g. it is fixed)
+void Presolve::removeFromGroup(int vm)
+{
+	int previous = m_groupPrevious[vm];
+	int next = m_groupNext[vm];
+	if (previous >= 0)
+		m_groupNext[previous] = next;
+	if (next >= 0)
+		m_groupPrevious[next] = previous;
+	m_groupPrevious[vm] = -1;
+	m_groupNext[vm] = -1;
+}
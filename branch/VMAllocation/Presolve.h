@@ -0,0 +1,95 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include <vector>
+
+#include "ProblemInstance.h"
+#include "PM.h"
+
+// reduction of an instance before the branch and bound search (the VM ids are not changed, the PMs are renumbered)
+// - PMs without initial VMs are interchangeable within a capacity class: only as many of them are kept as VMs fit into the class
+// - identical VMs (same demands and initial PM) are interchangeable: they are linked into groups, the search only allocates a group
+//   with non-decreasing PM ids along the group (one allocation of each multiset of PMs)
+// - the migration budget is at most the number of VMs which fit onto an other PM than their initial one
+class Presolve
+{
+	ProblemInstancePtr m_original; // instance before the reduction
+	ProblemInstancePtr m_instance; // reduced instance (the same as the original if no PMs were dropped)
+	std::vector<int> m_originalPM; // for each PM of the reduced instance
+	std::vector<int> m_reducedPM; // for each original PM (-1 if dropped)
+	std::vector<int> m_PMClass; // capacity class of each original PM
+	int m_numClasses;
+	std::vector<bool> m_interchangeable; // original PMs without initial VMs
+	std::vector<int> m_groupPrevious; // for each VM: previous VM of its group (-1 if none)
+	std::vector<int> m_groupNext; // for each VM: next VM of its group (-1 if none)
+	int m_numGroups; // groups with at least two VMs
+	int m_maxUsefulMigrations;
+
+	std::vector<std::vector<int>> freeSlots(const std::vector<PM>& PMs, const std::vector<bool>& used) const;
+	void swapIn(int pm, int slot);
+
+public:
+	Presolve(ProblemInstancePtr instance, bool enabled);
+
+	ProblemInstancePtr instance() const
+	{
+		return m_instance;
+	}
+	ProblemInstancePtr originalInstance() const
+	{
+		return m_original;
+	}
+	bool droppedPMs() const
+	{
+		return m_instance != m_original;
+	}
+	int numOriginalPMs() const
+	{
+		return m_original->numPMs;
+	}
+	int originalPM(int pm) const
+	{
+		return m_originalPM[pm];
+	}
+	int groupPrevious(int vm) const
+	{
+		return m_groupPrevious[vm];
+	}
+	int groupNext(int vm) const
+	{
+		return m_groupNext[vm];
+	}
+	int numGroups() const
+	{
+		return m_numGroups;
+	}
+	int maxUsefulMigrations() const
+	{
+		return m_maxUsefulMigrations;
+	}
+
+	std::vector<int> reducedPlacement(const std::vector<int>& placement, const std::vector<PM>& PMs, bool claim);
+	std::vector<bool> reducedAllowedPMs(const std::vector<bool>& allowedPMs, const std::vector<PM>& PMs);
+	void removeFromGroup(int vm);
+};
+
+#endif
@@ -17,25 +17,35 @@ You should have received a copy of the GNU General Public License
 along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 #include <fstream>
+#include <iostream>
 #include <cstdlib>
 
 #include "ProblemGenerator.h"
-#include "VM.h"
-#include "PM.h"
 
 bool ProblemGenerator::randomInitialized = false;
 
 ProblemGenerator::ProblemGenerator(int dim, int minrd, int maxrd, int minrs, int maxrs, int types)
-	:dimension(dim), minResDemand(minrd), maxResDemand(maxrd), minResSupply(minrs), maxResSupply(maxrs), numPMTypes(types)
+	:dimension(dim), minResDemand(minrd), maxResDemand(maxrd), minResSupply(minrs), maxResSupply(maxrs), numPMTypes(types), numClusters(0)
 {
 	if (!randomInitialized) // only initialize random generator once
 	{
 		randomInitialized = true;
 		srand((unsigned int)time(NULL));
 	}
+
+	if (!isValidResourceValue(minResDemand) || !isValidResourceValue(maxResDemand) || !isValidResourceValue(minResSupply) || !isValidResourceValue(maxResSupply))
+		std::cout << "Error: generated resource values cannot be stored, check COMPACT_RESOURCES." << std::endl;
+}
+
+// makes the generated instances reproducible
+void ProblemGenerator::setSeed(unsigned int seed)
+{
+	randomInitialized = true;
+	srand(seed);
 }
 
 int ProblemGenerator::randomIntBetween(int min, int max)
@@ -50,68 +60,75 @@ void ProblemGenerator::setNumVMsNumPMs(int nVMs, int nPMs)
 	numPMs = nPMs;
 }
 
-AllocationProblem ProblemGenerator::generate()
+void ProblemGenerator::setNumClusters(int n)
+{
+	numClusters = n;
+}
+
+ProblemInstance ProblemGenerator::generateInstance()
 {
-	std::vector<VM> VMs;
+	ProblemInstance instance(dimension, numVMs, numPMs);
 
 	// generate VMs
 	for (int i = 0; i < numVMs; i++)
 	{
-		VM vm;
 		for (int j = 0; j < dimension; j++)
-			vm.demand.push_back(randomIntBetween(minResDemand, maxResDemand));
-		vm.initialID = randomIntBetween(0, numPMs - 1);
-		vm.id = i;
-
-		VMs.push_back(vm);
+			instance.setDemand(i, j, randomIntBetween(minResDemand, maxResDemand));
+		instance.initialIDs[i] = randomIntBetween(0, numPMs - 1);
 	}
 
-	std::vector<PM> PMs;
-	std::vector<PM> PMTypes;
+	std::vector<std::vector<int>> PMTypes;
 
 	// generate PM types
 	for (int i = 0; i < numPMTypes; i++)
 	{
-		PM pm;
+		std::vector<int> capacity;
 
 		for (int j = 0; j < dimension; j++)
 		{
-			int cap = randomIntBetween(minResSupply, maxResSupply);
-			pm.capacity.push_back(cap);
-			pm.resourcesFree.push_back(cap);
+			capacity.push_back(randomIntBetween(minResSupply, maxResSupply));
 		}
 
-		PMTypes.push_back(pm);
+		PMTypes.push_back(capacity);
 	}
 	
 	// generate PMs
 	for (int i = 0; i < numPMs; i++)
 	{
-		PM pm = PMTypes[randomIntBetween(0, numPMTypes - 1)];
-		pm.id = i;
+		const std::vector<int>& capacity = PMTypes[randomIntBetween(0, numPMTypes - 1)];
+		for (int j = 0; j < dimension; j++)
+			instance.setCapacity(i, j, capacity[j]);
+	}
 
-		PMs.push_back(pm);
+	// clusters (racks) of consecutive PMs, the VMs belong to the cluster of their initial PM
+	if (numClusters > 0)
+	{
+		for (int i = 0; i < numPMs; i++)
+			instance.PMClusters.push_back((long long)i * numClusters / numPMs);
 	}
 
-	AllocationProblem problem;
-	problem.PMs = PMs;
-	problem.VMs = VMs;
-	return problem;
+	return instance;
+}
+
+ProblemInstancePtr ProblemGenerator::generate()
+{
+	return std::make_shared<const ProblemInstance>(generateInstance());
 }
 
-AllocationProblem ProblemGenerator::generate_ff()
+ProblemInstancePtr ProblemGenerator::generate_ff()
 {
-	AllocationProblem problem=generate();
-	for (unsigned i=0; i<problem.VMs.size(); i++)
+	ProblemInstance instance=generateInstance();
+	std::vector<ResourceValue> resourcesFree=instance.capacities; // dimension-major, as in the instance
+	for (int i=0; i<numVMs; i++)
 	{
 		bool found=false;
-		unsigned j=0;
-		while(!found && j<problem.PMs.size())
+		int j=0;
+		while(!found && j<numPMs)
 		{
 			bool fit=true;
-			for(unsigned k=0; k<problem.VMs[i].demand.size(); k++)
+			for(int k=0; k<dimension; k++)
 			{
-				if(problem.VMs[i].demand[k]>problem.PMs[j].resourcesFree[k])
+				if(instance.demand(i,k)>resourcesFree[k*numPMs+j])
 					fit=false;
 			}
 			if(fit)
@@ -120,24 +137,16 @@ AllocationProblem ProblemGenerator::generate_ff()
 		}
 		if(found)
 		{
-			problem.VMs[i].initialID=j-1;
-			for(unsigned k=0; k<problem.PMs[j-1].resourcesFree.size(); k++)
-				problem.PMs[j-1].resourcesFree[k]-=problem.VMs[i].demand[k];
+			instance.initialIDs[i]=j-1;
+			for(int k=0; k<dimension; k++)
+				resourcesFree[k*numPMs+j-1]-=instance.demand(i,k);
 		}
 	}
 
-	for(unsigned j=0; j<problem.PMs.size(); j++)
-	{
-		for(unsigned k=0; k<problem.PMs[j].resourcesFree.size(); k++)
-		{
-			problem.PMs[j].resourcesFree[k]=problem.PMs[j].capacity[k];
-		}
-	}
-
-	return problem;
+	return std::make_shared<const ProblemInstance>(std::move(instance));
 }
 
-AllocationProblem ProblemGenerator::testFromFile(std::string path)
+ProblemInstancePtr ProblemGenerator::testFromFile(std::string path)
 {
 	std::ifstream fileIn(path.c_str());
 	int nVMs;
@@ -148,44 +157,75 @@ AllocationProblem ProblemGenerator::testFromFile(std::string path)
 	fileIn >> nVMs;
 	fileIn >> nPMs;
 
-	std::vector<VM> VMs;
+	ProblemInstance instance(dimension, nVMs, nPMs);
 
 	//read VMs
 	for (int i = 0; i < nVMs; i++)
 	{
-		VM vm;
 		for (int j = 0; j < dimension; j++)
 		{
 			fileIn >> buffer;
-			vm.demand.push_back(buffer);
+			if (!instance.setDemand(i, j, buffer))
+				std::cout << "Error: invalid demand in " << path << std::endl;
 		}
 
 		fileIn >> buffer;
-		vm.initialID = buffer;
-		vm.id = i;
-		VMs.push_back(vm);
+		instance.initialIDs[i] = buffer;
 	}
 
-	std::vector<PM> PMs;
-
 	// read PMs
 	for (int i = 0; i < nPMs; i++)
 	{
-		PM pm;
-
 		for (int j = 0; j < dimension; j++)
 		{
 			fileIn >> buffer;
-			pm.capacity.push_back(buffer);
-			pm.resourcesFree.push_back(buffer);
+			if (!instance.setCapacity(i, j, buffer))
+				std::cout << "Error: invalid capacity in " << path << std::endl;
 		}
+	}
+
+	return std::make_shared<const ProblemInstance>(std::move(instance));
+}
 
-		pm.id = i;
-		PMs.push_back(pm);
+// random changes of a data center between two consolidation runs (the ids are the ones of the current instance):
+// a few VMs depart, arrive or get a new demand, and one PM goes into maintenance and is replaced by a new one
+ConsolidationDelta ProblemGenerator::generateDelta(const ProblemInstance& instance, const std::vector<int>& VMIds, const std::vector<int>& PMIds)
+{
+	ConsolidationDelta delta;
+	int numVMsChanged = std::max(1, (int)VMIds.size() / 20); // per kind of change
+	int nextVMId = VMIds.empty() ? 0 : *std::max_element(VMIds.begin(), VMIds.end()) + 1;
+	int nextPMId = PMIds.empty() ? 0 : *std::max_element(PMIds.begin(), PMIds.end()) + 1;
+
+	auto randomResources = [&](int id, int min, int max)
+	{
+		ConsolidationDelta::Resources resources;
+		resources.id = id;
+		for (int j = 0; j < instance.dimension; j++)
+			resources.values.push_back(randomIntBetween(min, max));
+		return resources;
+	};
+
+	// departed and resized VMs are distinct, they are taken from a random order of the VMs
+	std::vector<int> order(VMIds);
+	for (int i = 0; i + 1 < (int)order.size(); i++)
+		std::swap(order[i], order[randomIntBetween(i, order.size() - 1)]);
+	int numDeparted = std::min<int>(numVMsChanged, order.size());
+	int numResized = std::min<int>(numVMsChanged, order.size() - numDeparted);
+	for (int i = 0; i < numDeparted; i++)
+		delta.removedVMs.push_back(order[i]);
+	for (int i = numDeparted; i < numDeparted + numResized; i++)
+		delta.resizedVMs.push_back(randomResources(order[i], minResDemand, maxResDemand));
+	for (int i = 0; i < numVMsChanged; i++)
+		delta.addedVMs.push_back(randomResources(nextVMId++, minResDemand, maxResDemand));
+
+	if (!PMIds.empty())
+	{
+		int removed = randomIntBetween(0, PMIds.size() - 1);
+		delta.removedPMs.push_back(PMIds[removed]);
+		delta.addedPMs.push_back(randomResources(nextPMId, minResSupply, maxResSupply));
+		if (!instance.PMClusters.empty()) // the new PM replaces the removed one in its cluster
+			delta.addedPMs.back().cluster = instance.PMClusters[removed];
 	}
 
-	AllocationProblem problem;
-	problem.PMs = PMs;
-	problem.VMs = VMs;
-	return problem;
+	return delta;
 }
@@ -21,8 +21,10 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #define PROBLEMGENERATOR_H
 
 #include <string>
+#include <vector>
 
-#include "AllocationProblem.h"
+#include "ProblemInstance.h"
+#include "ConsolidationSession.h"
 
 
 class ProblemGenerator
@@ -37,15 +39,21 @@ private:
 	int minResSupply;
 	int maxResSupply;
 	int numPMTypes;
+	int numClusters; // PMs are split into this many clusters of consecutive PMs (0: no clusters)
 
 	static bool randomInitialized;
+
+	ProblemInstance generateInstance();
 public:
 	ProblemGenerator(int dimension, int minrd, int maxrd, int minrs, int maxrs, int types);
+	static void setSeed(unsigned int seed);
 	int randomIntBetween(int min, int max);
 	void setNumVMsNumPMs(int nVMs, int nPMs);
-	AllocationProblem generate();
-	AllocationProblem generate_ff();
-	AllocationProblem testFromFile(std::string path);
+	void setNumClusters(int n);
+	ProblemInstancePtr generate();
+	ProblemInstancePtr generate_ff();
+	ProblemInstancePtr testFromFile(std::string path);
+	ConsolidationDelta generateDelta(const ProblemInstance& instance, const std::vector<int>& VMIds, const std::vector<int>& PMIds);
 };
 
 #endif
\ No newline at end of file
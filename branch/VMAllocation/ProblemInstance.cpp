@@ -0,0 +1,118 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "ProblemInstance.h"
+
+// returns true if the value can be stored as a resource value
+bool isValidResourceValue(int value)
+{
+	return value >= 0 && value <= std::numeric_limits<ResourceValue>::max();
+}
+
+ProblemInstance::ProblemInstance()
+	:dimension(0), numVMs(0), numPMs(0)
+{
+
+}
+
+// creates an instance with zero demands and capacities, the values are set afterwards
+ProblemInstance::ProblemInstance(int dim, int nVMs, int nPMs)
+	:dimension(dim), numVMs(nVMs), numPMs(nPMs), demands((std::size_t)dim * nVMs, 0), initialIDs(nVMs, -1), capacities((std::size_t)dim * nPMs, 0)
+{
+
+}
+
+// returns false if the value cannot be stored
+bool ProblemInstance::setDemand(int vm, int d, int value)
+{
+	if (!isValidResourceValue(value))
+		return false;
+	demands[(std::size_t)d * numVMs + vm] = value;
+	return true;
+}
+
+bool ProblemInstance::setCapacity(int pm, int d, int value)
+{
+	if (!isValidResourceValue(value))
+		return false;
+	capacities[(std::size_t)d * numPMs + pm] = value;
+	return true;
+}
+
+// returns the capacity class of each PM: PMs with the same capacities (and in the same cluster) are in the same class
+// the classes are numbered in the order of their first PM
+std::vector<int> ProblemInstance::capacityClasses(int& numClasses) const
+{
+	std::map<std::pair<int, std::vector<ResourceValue>>, int> classOfCapacity;
+	std::vector<int> PMClass(numPMs);
+	std::vector<ResourceValue> capacity(dimension);
+	for (int pm = 0; pm < numPMs; pm++)
+	{
+		for (int d = 0; d < dimension; d++)
+			capacity[d] = this->capacity(pm, d);
+		int cluster = PMClusters.empty() ? 0 : PMClusters[pm];
+		auto inserted = classOfCapacity.insert(std::make_pair(std::make_pair(cluster, capacity), (int)classOfCapacity.size()));
+		PMClass[pm] = inserted.first->second;
+	}
+	numClasses = classOfCapacity.size();
+	return PMClass;
+}
+
+// returns true if the VM fits onto the PM when the PM is empty
+bool ProblemInstance::fitsEmpty(int vm, int pm) const
+{
+	for (int d = 0; d < dimension; d++)
+	{
+		if (demand(vm, d) > capacity(pm, d))
+			return false;
+	}
+	return true;
+}
+
+// instance of the given VMs and PMs (in the given order)
+// the initial IDs are mapped to the new PM indices, VMs with an initial PM outside the subset become new VMs
+ProblemInstance ProblemInstance::subInstance(const std::vector<int>& VMs, const std::vector<int>& PMs) const
+{
+	ProblemInstance sub(dimension, VMs.size(), PMs.size());
+
+	std::unordered_map<int, int> subIndexOf;
+	for (std::size_t i = 0; i < PMs.size(); i++)
+	{
+		subIndexOf[PMs[i]] = i;
+		for (int d = 0; d < dimension; d++)
+			sub.capacities[(std::size_t)d * sub.numPMs + i] = capacity(PMs[i], d);
+		if (!PMClusters.empty())
+			sub.PMClusters.push_back(PMClusters[PMs[i]]);
+	}
+
+	for (std::size_t i = 0; i < VMs.size(); i++)
+	{
+		for (int d = 0; d < dimension; d++)
+			sub.demands[(std::size_t)d * sub.numVMs + i] = demand(VMs[i], d);
+		auto initial = subIndexOf.find(initialIDs[VMs[i]]);
+		sub.initialIDs[i] = (initial == subIndexOf.end()) ? -1 : initial->second;
+	}
+
+	return sub;
+}
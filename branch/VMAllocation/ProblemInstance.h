@@ -0,0 +1,91 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PROBLEMINSTANCE_H
+#define PROBLEMINSTANCE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//#define COMPACT_RESOURCES // resource values are stored in 16 bits (every demand and capacity must be between 0 and 65535)
+
+#ifdef COMPACT_RESOURCES
+	using ResourceValue = uint16_t;
+#else
+	using ResourceValue = int;
+#endif
+
+// immutable data of a problem instance
+// shared by all allocators (and threads) solving the instance, their search state is kept in AllocationProblem
+// the resources are stored dimension-major, so the values of one resource are contiguous for all VMs or all PMs
+struct ProblemInstance
+{
+	int dimension;
+	int numVMs;
+	int numPMs;
+	std::vector<ResourceValue> demands; // demand of VM j in dimension d: demands[d * numVMs + j]
+	std::vector<int> initialIDs; // ID of initially assigned PM (-1 for new VMs)
+	std::vector<ResourceValue> capacities; // capacity of PM i in dimension d: capacities[d * numPMs + i]
+	std::vector<int> PMClusters; // cluster of PM i, VMs must stay in the cluster of their initial PM, new VMs may go anywhere (empty if the PMs are not clustered)
+
+	ProblemInstance();
+	ProblemInstance(int dim, int nVMs, int nPMs);
+
+	bool setDemand(int vm, int d, int value);
+	bool setCapacity(int pm, int d, int value);
+	ProblemInstance subInstance(const std::vector<int>& VMs, const std::vector<int>& PMs) const;
+	std::vector<int> capacityClasses(int& numClasses) const;
+	bool fitsEmpty(int vm, int pm) const;
+
+	// the clusters allow the VM on the PM
+	bool inCluster(int vm, int pm) const
+	{
+		return PMClusters.empty() || initialIDs[vm] < 0 || PMClusters[pm] == PMClusters[initialIDs[vm]];
+	}
+
+	ResourceValue demand(int vm, int d) const
+	{
+		return demands[(std::size_t)d * numVMs + vm];
+	}
+
+	ResourceValue capacity(int pm, int d) const
+	{
+		return capacities[(std::size_t)d * numPMs + pm];
+	}
+
+	// demands of all VMs in one dimension
+	const ResourceValue* demandsOf(int d) const
+	{
+		return &demands[(std::size_t)d * numVMs];
+	}
+
+	// capacities of all PMs in one dimension
+	const ResourceValue* capacitiesOf(int d) const
+	{
+		return &capacities[(std::size_t)d * numPMs];
+	}
+};
+
+using ProblemInstancePtr = std::shared_ptr<const ProblemInstance>;
+
+bool isValidResourceValue(int value);
+
+#endif
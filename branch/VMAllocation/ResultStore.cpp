@@ -0,0 +1,240 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include "ResultStore.h"
+#include "BufferedWriter.h"
+
+static ResultColumn makeColumn(const char* name, ResultColumnType type, std::size_t offset, std::size_t size)
+{
+	ResultColumn column;
+	std::memset(&column, 0, sizeof(column));
+	std::strncpy(column.name, name, sizeof(column.name) - 1);
+	column.type = type;
+	column.offset = offset;
+	column.size = size;
+	return column;
+}
+
+// columns of the current version, in the order they are exported
+std::vector<ResultColumn> resultSchema()
+{
+	std::vector<ResultColumn> schema;
+	schema.push_back(makeColumn("Instance id", INT64, offsetof(ResultRecord, instanceId), sizeof(int64_t)));
+	schema.push_back(makeColumn("Seed", UINT32, offsetof(ResultRecord, seed), sizeof(uint32_t)));
+	schema.push_back(makeColumn("VMs", INT32, offsetof(ResultRecord, numVMs), sizeof(int32_t)));
+	schema.push_back(makeColumn("PMs", INT32, offsetof(ResultRecord, numPMs), sizeof(int32_t)));
+	schema.push_back(makeColumn("Configuration", STRING, offsetof(ResultRecord, configName), RESULT_CONFIG_NAME_LENGTH));
+	schema.push_back(makeColumn("Runtime", DOUBLE, offsetof(ResultRecord, runtime), sizeof(double)));
+	schema.push_back(makeColumn("Cost", DOUBLE, offsetof(ResultRecord, cost), sizeof(double)));
+	schema.push_back(makeColumn("PMs on", INT32, offsetof(ResultRecord, activeHosts), sizeof(int32_t)));
+	schema.push_back(makeColumn("Migrations", INT32, offsetof(ResultRecord, migrations), sizeof(int32_t)));
+	schema.push_back(makeColumn("Lower bound", DOUBLE, offsetof(ResultRecord, lowerBound), sizeof(double)));
+	schema.push_back(makeColumn("Nodes", INT64, offsetof(ResultRecord, nodes), sizeof(int64_t)));
+	schema.push_back(makeColumn("Winner", STRING, offsetof(ResultRecord, winner), RESULT_CONFIG_NAME_LENGTH));
+	schema.push_back(makeColumn("Peak RSS (kB)", INT64, offsetof(ResultRecord, peakMemory), sizeof(int64_t)));
+	return schema;
+}
+
+// opens the file for appending, the header is only written into new files
+// an existing file is only appended to if it was written with the same columns
+ResultWriter::ResultWriter(const std::string& path)
+{
+	std::vector<ResultColumn> schema = resultSchema();
+	uint32_t header[4] = { 0, RESULT_FILE_VERSION, (uint32_t)schema.size(), (uint32_t)sizeof(ResultRecord) };
+	std::memcpy(header, "VMAR", 4);
+
+	m_file = std::fopen(path.c_str(), "ab+");
+	if (!m_file)
+		return;
+
+	std::fseek(m_file, 0, SEEK_END);
+	if (std::ftell(m_file) == 0)
+	{
+		std::fwrite(header, sizeof(header), 1, m_file);
+		std::fwrite(&schema[0], sizeof(ResultColumn), schema.size(), m_file);
+		return;
+	}
+
+	uint32_t fileHeader[4];
+	std::vector<ResultColumn> fileSchema(schema.size());
+	std::fseek(m_file, 0, SEEK_SET);
+	if (std::fread(fileHeader, sizeof(fileHeader), 1, m_file) != 1 || std::memcmp(fileHeader, header, sizeof(header)) != 0
+		|| std::fread(&fileSchema[0], sizeof(ResultColumn), schema.size(), m_file) != schema.size()
+		|| std::memcmp(&fileSchema[0], &schema[0], schema.size() * sizeof(ResultColumn)) != 0)
+	{
+		std::cout << "Result file " << path << " was written by an other version, not appending to it" << std::endl;
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+ResultWriter::~ResultWriter()
+{
+	if (m_file)
+		std::fclose(m_file);
+}
+
+bool ResultWriter::good()
+{
+	return m_file != nullptr;
+}
+
+void ResultWriter::append(const ResultRecord& record)
+{
+	if (m_file)
+		std::fwrite(&record, sizeof(record), 1, m_file);
+}
+
+// makes the rows written so far visible to readers
+void ResultWriter::flush()
+{
+	if (m_file)
+		std::fflush(m_file);
+}
+
+// reads all rows of a result file, columns are matched by name, so files of other versions can be read as well
+bool ResultReader::read(const std::string& path)
+{
+	m_records.clear();
+
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		std::cout << "Cannot open result file " << path << std::endl;
+		return false;
+	}
+
+	uint32_t header[4];
+	if (std::fread(header, sizeof(header), 1, file) != 1 || std::memcmp(header, "VMAR", 4) != 0)
+	{
+		std::cout << "Invalid result file " << path << std::endl;
+		std::fclose(file);
+		return false;
+	}
+	uint32_t numColumns = header[2];
+	uint32_t rowSize = header[3];
+
+	std::vector<ResultColumn> fileColumns(numColumns);
+	if (numColumns > 0 && std::fread(&fileColumns[0], sizeof(ResultColumn), numColumns, file) != numColumns)
+	{
+		std::cout << "Invalid result file " << path << std::endl;
+		std::fclose(file);
+		return false;
+	}
+
+	// mapping the columns of the file to the columns of the current version
+	std::vector<ResultColumn> schema = resultSchema();
+	std::vector<int> fileColumnOf(schema.size(), -1);
+	for (std::size_t i = 0; i < schema.size(); i++)
+	{
+		for (uint32_t j = 0; j < numColumns; j++)
+		{
+			if (std::strncmp(schema[i].name, fileColumns[j].name, sizeof(schema[i].name)) == 0 && schema[i].type == fileColumns[j].type
+				&& fileColumns[j].offset + fileColumns[j].size <= rowSize)
+			{
+				fileColumnOf[i] = j;
+			}
+		}
+	}
+
+	std::vector<char> row(rowSize);
+	while (rowSize > 0 && std::fread(&row[0], rowSize, 1, file) == 1)
+	{
+		ResultRecord record;
+		std::memset(&record, 0, sizeof(record));
+		record.cost = record.lowerBound = -1;
+		record.activeHosts = record.migrations = -1;
+		record.nodes = -1;
+		record.peakMemory = -1;
+
+		for (std::size_t i = 0; i < schema.size(); i++)
+		{
+			if (fileColumnOf[i] < 0)
+				continue;
+			const ResultColumn& column = fileColumns[fileColumnOf[i]];
+			std::size_t size = (column.size < schema[i].size) ? column.size : schema[i].size;
+			std::memcpy(reinterpret_cast<char*>(&record) + schema[i].offset, &row[column.offset], size);
+		}
+		record.configName[RESULT_CONFIG_NAME_LENGTH - 1] = '\0';
+		record.winner[RESULT_CONFIG_NAME_LENGTH - 1] = '\0';
+
+		m_records.push_back(record);
+	}
+
+	std::fclose(file);
+	return true;
+}
+
+const std::vector<ResultRecord>& ResultReader::getRecords()
+{
+	return m_records;
+}
+
+// writes the rows in a semicolon separated text file, one row per line
+bool ResultReader::exportCsv(const std::string& path)
+{
+	BufferedWriter csv(path);
+	if (!csv.good())
+	{
+		std::cout << "Cannot create CSV file " << path << std::endl;
+		return false;
+	}
+
+	std::vector<ResultColumn> schema = resultSchema();
+	for (const auto& column : schema)
+	{
+		csv << column.name << "; ";
+	}
+	csv << "\n";
+
+	for (const auto& record : m_records)
+	{
+		for (const auto& column : schema)
+		{
+			const char* value = reinterpret_cast<const char*>(&record) + column.offset;
+			switch (column.type)
+			{
+			case INT32:
+				csv << *reinterpret_cast<const int32_t*>(value);
+				break;
+			case UINT32:
+				csv << (long long)*reinterpret_cast<const uint32_t*>(value);
+				break;
+			case INT64:
+				csv << (long long)*reinterpret_cast<const int64_t*>(value);
+				break;
+			case DOUBLE:
+				csv << *reinterpret_cast<const double*>(value);
+				break;
+			case STRING:
+				csv << value;
+				break;
+			}
+			csv << "; ";
+		}
+		csv << "\n";
+	}
+
+	csv.close();
+	return true;
+}
@@ -0,0 +1,96 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define RESULT_FILE_VERSION 1
+#define RESULT_CONFIG_NAME_LENGTH 32
+
+// one row of the result store: the result of one configuration on one instance
+struct ResultRecord
+{
+	int64_t instanceId;
+	uint32_t seed; // seed of the generator for this instance
+	int32_t numVMs;
+	int32_t numPMs;
+	char configName[RESULT_CONFIG_NAME_LENGTH]; // zero terminated
+	double runtime;
+	double cost; // -1 if no allocation was found
+	int32_t activeHosts; // -1 if unknown
+	int32_t migrations; // -1 if unknown
+	double lowerBound;
+	int64_t nodes; // number of search nodes, -1 if unknown
+	char winner[RESULT_CONFIG_NAME_LENGTH]; // configuration which found the allocation, for allocators running several ones (zero terminated)
+	int64_t peakMemory; // peak resident set size during the run in kB (of the whole process if it cannot be reset), -1 if unknown
+};
+
+enum ResultColumnType
+{
+	INT32,
+	UINT32,
+	INT64,
+	DOUBLE,
+	STRING
+};
+
+// describes one column in the header of a result file, the header makes the files self-describing
+struct ResultColumn
+{
+	char name[24];
+	uint32_t type; // ResultColumnType
+	uint32_t offset; // offset of the value in a row
+	uint32_t size; // size of the value in bytes
+};
+
+// binary result file:
+// "VMAR", version, number of columns, row size (uint32 each), column descriptors, then fixed size rows
+class ResultWriter
+{
+	std::FILE* m_file;
+
+public:
+	ResultWriter(const std::string& path);
+	~ResultWriter();
+	ResultWriter(const ResultWriter&) = delete;
+	ResultWriter& operator=(const ResultWriter&) = delete;
+
+	bool good();
+	void append(const ResultRecord& record);
+	void flush();
+};
+
+class ResultReader
+{
+	std::vector<ResultRecord> m_records;
+
+public:
+	bool read(const std::string& path);
+	const std::vector<ResultRecord>& getRecords();
+	bool exportCsv(const std::string& path);
+};
+
+std::vector<ResultColumn> resultSchema();
+
+#endif
@@ -0,0 +1,45 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHAREDBOUND_H
+#define SHAREDBOUND_H
+
+#include <atomic>
+#include <limits>
+
+// best cost found by any of several allocators racing on the same problem, each of them bounds with it
+// stop is set when the race is over (one of them proved that the best cost is optimal)
+struct SharedBound
+{
+	std::atomic<double> bestCost;
+	std::atomic<bool> stop;
+
+	SharedBound() : bestCost(std::numeric_limits<double>::max()), stop(false) {}
+
+	// lowers the best cost if the new cost is better
+	void offer(double cost)
+	{
+		double best = bestCost.load(std::memory_order_relaxed);
+		while (cost < best && !bestCost.compare_exchange_weak(best, cost, std::memory_order_relaxed))
+		{
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads)
+	:m_numRunning(0), m_stopping(false)
+{
+	if (numThreads < 1)
+		numThreads = 1;
+	for (int i = 0; i < numThreads; i++)
+		m_workers.emplace_back(&ThreadPool::work, this);
+}
+
+// waits for the submitted tasks, then stops the workers
+ThreadPool::~ThreadPool()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this] {return m_stopping || !m_tasks.empty(); });
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+			m_numRunning++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_numRunning--;
+			if (m_numRunning == 0 && m_tasks.empty())
+				m_allDone.notify_all();
+		}
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push(std::move(task));
+	}
+	m_taskAvailable.notify_one();
+}
+
+// blocks until every submitted task is finished
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_allDone.wait(lock, [this] {return m_numRunning == 0 && m_tasks.empty(); });
+}
+
+int ThreadPool::getNumThreads()
+{
+	return m_workers.size();
+}
@@ -21,11 +21,11 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 void Timer::start()
 {
-	m_beginTime = clock();
+	m_beginTime = std::chrono::steady_clock::now();
 }
 
 double Timer::getElapsedTime()
 {
-	double elapsed = double(clock() - m_beginTime) / CLOCKS_PER_SEC;
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_beginTime).count();
 	return elapsed;
 }
\ No newline at end of file
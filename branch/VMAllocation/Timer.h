@@ -20,11 +20,11 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #ifndef TIMER_H
 #define TIMER_H
 
-#include <ctime>
+#include <chrono>
 
 class Timer
 {
-	clock_t m_beginTime;
+	std::chrono::steady_clock::time_point m_beginTime; // wall clock, the allocators may use several threads
 public:
 	void start();
 	double getElapsedTime();
@@ -0,0 +1,376 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "Tuner.h"
+#include "BnBAllocator.h"
+#include "InstanceFile.h"
+
+// tuned parameters and their values, as written in the config file
+struct TunedParameter
+{
+	const char* name;
+	std::vector<std::string> values;
+};
+
+enum TunedParameterIndex
+{
+	FAIL_FIRST,
+	INTELLIGENT_BOUND,
+	VM_SORT_METHOD,
+	PM_SORT_METHOD,
+	INITIAL_PM_FIRST,
+	SYMMETRY_BREAKING,
+	BOUND_THRESHOLD,
+	VM_SELECTION,
+	PM_SCORING,
+	INCUMBENT_PM_FIRST
+};
+
+static const std::vector<TunedParameter> tunedParameters =
+{
+	{ "failFirst", { "true", "false" } },
+	{ "intelligentBound", { "true", "false" } },
+	{ "VMSortMethod", { "NONE", "LEXICOGRAPHIC", "MAXIMUM", "SUM" } }, // in the order of SortType
+	{ "PMSortMethod", { "NONE", "LEXICOGRAPHIC", "MAXIMUM", "SUM" } },
+	{ "initialPMFirst", { "true", "false" } },
+	{ "symmetryBreaking", { "true", "false" } },
+	{ "boundThreshold", { "1", "0.99", "0.95", "0.9" } },
+	{ "VMSelection", { "MIN_DOMAIN", "DOMAIN_DEMAND", "MAX_REGRET", "DOM_WDEG" } }, // in the order of VMSelectionType
+	{ "PMScoring", { "UNSCORED", "DOT_PRODUCT", "L2_RESIDUAL", "DOMINANT_FIT" } }, // in the order of PMScoreType
+	{ "incumbentPMFirst", { "true", "false" } }
+};
+
+Tuner::Tuner(ConfigParser& parser, double budget)
+	:m_budget(budget), m_numRuns(0)
+{
+	long long seed = parser.getSeed();
+	m_random.seed((seed >= 0) ? (unsigned int)seed : (unsigned int)time(NULL));
+
+	m_baseParams.timeout = -1; // no BnB configuration yet
+	for (const auto& params : parser.getParamsList())
+	{
+		if (params->allocatorType == BnB)
+		{
+			m_baseParams = *std::dynamic_pointer_cast<BnBParams>(params);
+			break;
+		}
+	}
+
+	createCorpus(parser);
+}
+
+// returns true if there is something to tune: a BnB configuration and at least one instance
+bool Tuner::good()
+{
+	return m_baseParams.timeout >= 0 && !m_corpus.empty();
+}
+
+// the instances of the config file (generated in the same way as by a simulation, or the instance file), in random order
+void Tuner::createCorpus(ConfigParser& parser)
+{
+	if (!parser.getInstanceFile().empty())
+	{
+		InstanceFile instanceFile;
+		ProblemInstancePtr instance;
+		if (instanceFile.open(parser.getInstanceFile()) && (instance = instanceFile.toInstance()))
+			m_corpus.push_back(instance);
+		return;
+	}
+
+	std::unique_ptr<ProblemGenerator> generator = parser.getGenerator();
+	unsigned int baseSeed = (parser.getSeed() >= 0) ? (unsigned int)parser.getSeed() : (unsigned int)time(NULL);
+	ConfigParser::Steps vmSteps = parser.getVMs();
+	ConfigParser::Steps pmSteps = parser.getPMs();
+	int instanceId = 0;
+	for (int numVMs = vmSteps.from, numPMs = pmSteps.from; numVMs <= vmSteps.to && numPMs <= pmSteps.to; numVMs += vmSteps.step, numPMs += pmSteps.step)
+	{
+		generator->setNumVMsNumPMs(numVMs, numPMs);
+		for (int i = 0; i < parser.getNumTests(); i++, instanceId++)
+		{
+			ProblemGenerator::setSeed(baseSeed + instanceId); // same instances as the simulation with this config file
+			m_corpus.push_back(generator->generate_ff());
+		}
+		if (vmSteps.step <= 0 && pmSteps.step <= 0)
+			break;
+	}
+	std::shuffle(m_corpus.begin(), m_corpus.end(), m_random);
+}
+
+// number of configurations to start with: the most (a power of two) whose runs fit into the budget even if every run times out
+int Tuner::numInitialCandidates(int numFirstInstances)
+{
+	int spaceSize = 1;
+	for (const auto& parameter : tunedParameters)
+		spaceSize *= parameter.values.size();
+
+	int numCorpus = m_corpus.size();
+	int best = 2;
+	for (int numCandidates = 2; numCandidates <= spaceSize; numCandidates *= 2)
+	{
+		double worstCase = 0;
+		int evaluated = 0;
+		for (int n = numCandidates, m = numFirstInstances; n > 1; n = (n + 1) / 2, m *= 2)
+		{
+			worstCase += (double)n * (std::min(numCorpus, m) - evaluated) * m_baseParams.timeout;
+			evaluated = std::min(numCorpus, m);
+		}
+		if (worstCase > m_budget)
+			break;
+		best = numCandidates;
+	}
+	return best;
+}
+
+// the configuration of the config file, then distinct random points of the configuration space
+void Tuner::sampleCandidates(int numCandidates)
+{
+	std::vector<int> base(tunedParameters.size(), 0);
+	base[FAIL_FIRST] = m_baseParams.failFirst ? 0 : 1;
+	base[INTELLIGENT_BOUND] = m_baseParams.intelligentBound ? 0 : 1;
+	base[VM_SORT_METHOD] = m_baseParams.VMSortMethod;
+	base[PM_SORT_METHOD] = m_baseParams.PMSortMethod;
+	base[INITIAL_PM_FIRST] = m_baseParams.initialPMFirst ? 0 : 1;
+	base[SYMMETRY_BREAKING] = m_baseParams.symmetryBreaking ? 0 : 1;
+	base[VM_SELECTION] = m_baseParams.VMSelection;
+	base[PM_SCORING] = m_baseParams.PMScoring;
+	base[INCUMBENT_PM_FIRST] = m_baseParams.incumbentPMFirst ? 0 : 1;
+	for (std::size_t i = 0; i < tunedParameters[BOUND_THRESHOLD].values.size(); i++)
+	{
+		if (std::stod(tunedParameters[BOUND_THRESHOLD].values[i]) == m_baseParams.boundThreshold)
+			base[BOUND_THRESHOLD] = i;
+	}
+
+	std::set<std::vector<int>> sampled;
+	sampled.insert(base);
+	m_candidates.push_back({ base, {}, {} });
+	while ((int)m_candidates.size() < numCandidates)
+	{
+		std::vector<int> values(tunedParameters.size());
+		for (std::size_t i = 0; i < tunedParameters.size(); i++)
+			values[i] = std::uniform_int_distribution<int>(0, tunedParameters[i].values.size() - 1)(m_random);
+		if (sampled.insert(values).second)
+			m_candidates.push_back({ values, {}, {} });
+	}
+}
+
+// BnB parameters of a point of the configuration space
+BnBParams Tuner::configuration(const std::vector<int>& values)
+{
+	BnBParams params = m_baseParams;
+	params.failFirst = (values[FAIL_FIRST] == 0);
+	params.intelligentBound = (values[INTELLIGENT_BOUND] == 0);
+	params.VMSortMethod = stringToSortType(tunedParameters[VM_SORT_METHOD].values[values[VM_SORT_METHOD]]);
+	params.PMSortMethod = stringToSortType(tunedParameters[PM_SORT_METHOD].values[values[PM_SORT_METHOD]]);
+	params.initialPMFirst = (values[INITIAL_PM_FIRST] == 0);
+	params.symmetryBreaking = (values[SYMMETRY_BREAKING] == 0);
+	params.boundThreshold = std::stod(tunedParameters[BOUND_THRESHOLD].values[values[BOUND_THRESHOLD]]);
+	params.VMSelection = stringToVMSelectionType(tunedParameters[VM_SELECTION].values[values[VM_SELECTION]]);
+	params.PMScoring = stringToPMScoreType(tunedParameters[PM_SCORING].values[values[PM_SCORING]]);
+	params.incumbentPMFirst = (values[INCUMBENT_PM_FIRST] == 0);
+	return params;
+}
+
+// runs the candidate on the first instances of the corpus it was not run on yet, returns false if the budget ran out
+bool Tuner::evaluate(Candidate& candidate, int numInstances)
+{
+	auto params = std::make_shared<BnBParams>(configuration(candidate.values));
+	std::ostream noLog(nullptr);
+	for (int i = candidate.costs.size(); i < numInstances; i++)
+	{
+		if (m_timer.getElapsedTime() >= m_budget)
+			return false;
+
+		Timer runTimer;
+		runTimer.start();
+		BnBAllocator allocator(m_corpus[i], params, noLog);
+		allocator.solve();
+		double cost = allocator.getBestCost();
+		candidate.runtimes.push_back(runTimer.getElapsedTime());
+		candidate.costs.push_back(cost);
+		if (cost >= 0 && (m_bestKnownCosts[i] < 0 || cost < m_bestKnownCosts[i]))
+			m_bestKnownCosts[i] = cost;
+		m_numRuns++;
+	}
+	return true;
+}
+
+// mean relative distance from the best known cost on the first instances (1 if no allocation was found)
+double Tuner::meanGap(const Candidate& candidate, int numInstances)
+{
+	double sum = 0;
+	for (int i = 0; i < numInstances; i++)
+	{
+		if (candidate.costs[i] < 0)
+			sum += 1;
+		else if (m_bestKnownCosts[i] > 0)
+			sum += (candidate.costs[i] - m_bestKnownCosts[i]) / m_bestKnownCosts[i];
+	}
+	return sum / numInstances;
+}
+
+double Tuner::meanRuntime(const Candidate& candidate, int numInstances)
+{
+	double sum = 0;
+	for (int i = 0; i < numInstances; i++)
+		sum += candidate.runtimes[i];
+	return sum / numInstances;
+}
+
+// orders the candidates by their results on the first instances: smaller gap first, then the faster one
+void Tuner::rank(std::vector<int>& candidates, int numInstances)
+{
+	std::stable_sort(candidates.begin(), candidates.end(), [this, numInstances](int c1, int c2)
+	{
+		double gap1 = meanGap(m_candidates[c1], numInstances);
+		double gap2 = meanGap(m_candidates[c2], numInstances);
+		if (std::fabs(gap1 - gap2) > 1e-9)
+			return gap1 < gap2;
+		return meanRuntime(m_candidates[c1], numInstances) < meanRuntime(m_candidates[c2], numInstances);
+	});
+}
+
+// successive halving, then the report: the best configuration as an Allocator{} block and the sensitivity of each parameter
+void Tuner::run(std::ostream& report)
+{
+	m_timer.start();
+	m_bestKnownCosts.assign(m_corpus.size(), -1);
+
+	int numCorpus = m_corpus.size();
+	int numFirstInstances = std::min(numCorpus, 2);
+	sampleCandidates(numInitialCandidates(numFirstInstances));
+	std::cout << "Tuning " << m_candidates.size() << " configurations on " << numCorpus << " instances, budget: " << m_budget << " s" << std::endl;
+
+	std::vector<int> survivors(m_candidates.size());
+	for (std::size_t i = 0; i < survivors.size(); i++)
+		survivors[i] = i;
+
+	int numInstances = numFirstInstances;
+	int numRanked = 0; // the survivors are ranked on this many instances
+	while (true)
+	{
+		std::vector<int> finished;
+		for (int candidate : survivors)
+		{
+			if (!evaluate(m_candidates[candidate], numInstances))
+				break;
+			finished.push_back(candidate);
+		}
+
+		if (finished.size() < survivors.size()) // out of budget: the ones which finished the round, else the ranking of the previous round
+		{
+			std::cout << "\tbudget exhausted" << std::endl;
+			if (!finished.empty())
+			{
+				survivors = finished;
+				numRanked = numInstances;
+				rank(survivors, numRanked);
+			}
+			break;
+		}
+
+		numRanked = numInstances;
+		rank(survivors, numRanked);
+		std::cout << "\t" << survivors.size() << " configurations on " << numInstances << " instances, best mean gap: " << 100 * meanGap(m_candidates[survivors[0]], numRanked) << "%" << std::endl;
+		if (survivors.size() == 1 || numInstances == numCorpus)
+			break;
+
+		survivors.resize((survivors.size() + 1) / 2);
+		numInstances = std::min(numCorpus, 2 * numInstances);
+	}
+
+	report << "Tuning of the BnB parameters" << std::endl;
+	report << "\tinstances: " << numCorpus << ", configurations: " << m_candidates.size() << ", runs: " << m_numRuns << ", time: " << m_timer.getElapsedTime() << " s (budget: " << m_budget << " s)" << std::endl << std::endl;
+	if (numRanked == 0)
+	{
+		report << "The budget is too small for a single round." << std::endl;
+		std::cout << "The budget is too small for a single round." << std::endl;
+		return;
+	}
+
+	const Candidate& best = m_candidates[survivors[0]];
+	report << "Best configuration (mean gap: " << 100 * meanGap(best, numRanked) << "%, mean runtime: " << meanRuntime(best, numRanked) << " s on " << numRanked << " instances):" << std::endl;
+	writeConfiguration(report, best.values);
+	report << std::endl;
+	writeSensitivity(report, numFirstInstances);
+
+	writeConfiguration(std::cout, best.values);
+}
+
+void Tuner::writeConfiguration(std::ostream& out, const std::vector<int>& values)
+{
+	out << "Allocator{" << std::endl;
+	out << "allocatorType=BnB" << std::endl;
+	out << "name=Tuned" << std::endl;
+	out << "timeout=" << m_baseParams.timeout << std::endl;
+	out << "maxMigrationsRatio=" << m_baseParams.maxMigrationsRatio << std::endl;
+	out << "presolve=" << (m_baseParams.presolve ? "true" : "false") << std::endl;
+	for (std::size_t i = 0; i < tunedParameters.size(); i++)
+		out << tunedParameters[i].name << "=" << tunedParameters[i].values[values[i]] << std::endl;
+	out << "}" << std::endl;
+}
+
+// mean results of the configurations with each value of each parameter, on the instances of the first round (every configuration was run on them)
+// the spread is the difference of the best and the worst value
+void Tuner::writeSensitivity(std::ostream& out, int numInstances)
+{
+	out << "Sensitivity (mean over the configurations on the first " << numInstances << " instances):" << std::endl;
+	for (std::size_t p = 0; p < tunedParameters.size(); p++)
+	{
+		const TunedParameter& parameter = tunedParameters[p];
+		std::vector<double> gaps(parameter.values.size(), 0);
+		std::vector<double> runtimes(parameter.values.size(), 0);
+		std::vector<int> counts(parameter.values.size(), 0);
+		for (const auto& candidate : m_candidates)
+		{
+			if ((int)candidate.costs.size() < numInstances)
+				continue;
+			gaps[candidate.values[p]] += meanGap(candidate, numInstances);
+			runtimes[candidate.values[p]] += meanRuntime(candidate, numInstances);
+			counts[candidate.values[p]]++;
+		}
+
+		double minGap = 1, maxGap = 0;
+		for (std::size_t v = 0; v < parameter.values.size(); v++)
+		{
+			if (counts[v] == 0)
+				continue;
+			gaps[v] /= counts[v];
+			runtimes[v] /= counts[v];
+			minGap = std::min(minGap, gaps[v]);
+			maxGap = std::max(maxGap, gaps[v]);
+		}
+
+		out << parameter.name << " (spread of the mean gap: " << 100 * std::max(0.0, maxGap - minGap) << "%)" << std::endl;
+		for (std::size_t v = 0; v < parameter.values.size(); v++)
+		{
+			out << "\t" << parameter.values[v] << ": ";
+			if (counts[v] == 0)
+				out << "not sampled" << std::endl;
+			else
+				out << counts[v] << " configurations, mean gap: " << 100 * gaps[v] << "%, mean runtime: " << runtimes[v] << " s" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/*
+Copyright 2015 David Bartok, Zoltan Adam Mann
+
+This file is part of VMAllocation.
+
+VMAllocation is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+VMAllocation is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <vector>
+#include <random>
+#include <ostream>
+
+#include "ConfigParser.h"
+#include "BnBParams.h"
+#include "Timer.h"
+
+// searches the space of the BnB search parameters with successive halving over a corpus of instances:
+// a random sample of configurations is run on a few instances, the better half is kept and run on twice as many instances, and so on
+// the corpus and the fixed parameters (timeout, migration limit, cost model) are taken from the config file
+class Tuner
+{
+	// one point of the configuration space (index of the value of each tuned parameter) and its results so far
+	struct Candidate
+	{
+		std::vector<int> values;
+		std::vector<double> costs; // on the first instances of the corpus, -1 if no allocation was found
+		std::vector<double> runtimes;
+	};
+
+	std::vector<ProblemInstancePtr> m_corpus; // in random order, every round uses a prefix of it
+	BnBParams m_baseParams; // first BnB configuration of the config file
+	double m_budget; // CPU time of all runs in seconds
+	Timer m_timer;
+	std::mt19937 m_random;
+
+	std::vector<Candidate> m_candidates;
+	std::vector<double> m_bestKnownCosts; // best cost of any run on each instance (-1 if none yet)
+	int m_numRuns;
+
+	void createCorpus(ConfigParser& parser);
+	int numInitialCandidates(int numFirstInstances);
+	void sampleCandidates(int numCandidates);
+	BnBParams configuration(const std::vector<int>& values);
+	bool evaluate(Candidate& candidate, int numInstances);
+	double meanGap(const Candidate& candidate, int numInstances);
+	double meanRuntime(const Candidate& candidate, int numInstances);
+	void rank(std::vector<int>& candidates, int numInstances);
+	void writeConfiguration(std::ostream& out, const std::vector<int>& values);
+	void writeSensitivity(std::ostream& out, int numInstances);
+
+public:
+	Tuner(ConfigParser& parser, double budget);
+	bool good();
+	void run(std::ostream& report);
+};
+
+#endif
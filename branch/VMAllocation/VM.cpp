@@ -22,37 +22,43 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 // all functions sort in some kind of descending order
 
 // lexicographic order
-bool LexicographicVMComparator(const VM& first, const VM& second)
+bool LexicographicVMComparator::operator()(const VM& first, const VM& second) const
 {
-	return first.demand > second.demand;
+	for (int i = 0; i < instance.dimension; i++)
+	{
+		if (instance.demand(first.id, i) != instance.demand(second.id, i))
+			return instance.demand(first.id, i) > instance.demand(second.id, i);
+	}
+
+	return false;
 }
 
 // maximum of resources
-bool MaximumVMComparator(const VM& first, const VM& second)
+bool MaximumVMComparator::operator()(const VM& first, const VM& second) const
 {
 	int firstMax = 0;
 	int secondMax = 0;
-	for (std::size_t i = 0; i < first.demand.size(); i++)
+	for (int i = 0; i < instance.dimension; i++)
 	{
-		if (first.demand[i] > firstMax)
-			firstMax = first.demand[i];
+		if (instance.demand(first.id, i) > firstMax)
+			firstMax = instance.demand(first.id, i);
 
-		if (second.demand[i] > secondMax)
-			secondMax = second.demand[i];
+		if (instance.demand(second.id, i) > secondMax)
+			secondMax = instance.demand(second.id, i);
 	}
 
 	return firstMax > secondMax;
 }
 
 // sum of resources
-bool SumVMComparator(const VM& first, const VM& second)
+bool SumVMComparator::operator()(const VM& first, const VM& second) const
 {
 	int firstSum = 0;
 	int secondSum = 0;
-	for (std::size_t i = 0; i < first.demand.size(); i++)
+	for (int i = 0; i < instance.dimension; i++)
 	{
-		firstSum += first.demand[i];
-		secondSum += second.demand[i];
+		firstSum += instance.demand(first.id, i);
+		secondSum += instance.demand(second.id, i);
 	}
 
 	return firstSum > secondSum;
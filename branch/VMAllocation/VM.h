@@ -23,24 +23,38 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "PM.h"
+#include "ProblemInstance.h"
 
 struct VM
 {
-	int id;
-	std::vector<int> demand;
+	int id; // index of the VM in the instance data
 	int initialID; // ID of initially assigned PM
 	PM* initialPM;
-	std::vector<PM*>::iterator PMIterator; // "index" in the availablePMs array
-	std::vector<PM*> availablePMs;
+	int PMIndex; // position of the next candidate PM in the PM order of the search (negative: one of the PMs tried first, the incumbent and the initial PM)
+	int domainSize; // number of PMs the VM fits into in the current state (maintained while the VM is not allocated)
 };
 
-bool VMComparator(const VM& first, const VM& second);
-
-bool LexicographicVMComparator(const VM& first, const VM& second);
+// VM comparators, they read the demands from the instance
+struct LexicographicVMComparator
+{
+	const ProblemInstance& instance;
+	LexicographicVMComparator(const ProblemInstance& inst) : instance(inst) {}
+	bool operator()(const VM& first, const VM& second) const;
+};
 
-bool MaximumVMComparator(const VM& first, const VM& second);
+struct MaximumVMComparator
+{
+	const ProblemInstance& instance;
+	MaximumVMComparator(const ProblemInstance& inst) : instance(inst) {}
+	bool operator()(const VM& first, const VM& second) const;
+};
 
-bool SumVMComparator(const VM& first, const VM& second);
+struct SumVMComparator
+{
+	const ProblemInstance& instance;
+	SumVMComparator(const ProblemInstance& inst) : instance(inst) {}
+	bool operator()(const VM& first, const VM& second) const;
+};
 
 
 #endif
\ No newline at end of file
@@ -22,11 +22,10 @@ along with VMAllocation. If not, see <http://www.gnu.org/licenses/>.
 
 #include <functional>
 #include <unordered_map>
+#include <string>
 
 #include "AllocationProblem.h"
-
-#define COEFF_NR_OF_ACTIVE_HOSTS 10
-#define COEFF_NR_OF_MIGRATIONS 1
+#include "CostModel.h"
 
 using AllocationMapType = std::unordered_map <VM*, PM*>;
 
@@ -58,6 +57,24 @@ public:
 	{
 		throw std::bad_function_call("getMigrations() is not implemented for this class");
 	}
+
+	// returns the number of search nodes explored (-1 if the allocator cannot tell)
+	virtual long long getNodeCount()
+	{
+		return -1;
+	}
+
+	// returns the name of the configuration which found the best allocation, if the allocator runs several ones (empty otherwise)
+	virtual std::string getWinner()
+	{
+		return "";
+	}
+
+	// sets a known allocation (possibly of an other allocator on the same problem, VMs and PMs are matched by id) as the starting incumbent
+	// allocators which cannot use it ignore it
+	virtual void setIncumbent(const AllocationMapType&)
+	{
+	}
 };
 
 #endif
@@ -25,6 +25,16 @@ is a research prototype intended only for internal usage.
 /*
 Test configurations can be set up in the this file.
 Result files are created in the .\logs folder.
+
+Converting a text instance (format of ProblemGenerator::testFromFile) to a binary instance file:
+	vmallocation convert <text file> <binary file> <dimension>
+
+Every result is also appended to a binary result store (logs folder, or the resultFile key),
+exporting a result store to a CSV file:
+	vmallocation export <result file> <CSV file>
+
+With consolidationSteps=N, the best allocation of each instance is the starting state of N consolidation runs
+(random VM and PM changes, re-optimized by the first BnB configuration), stored as "Consolidation <step>" results.
 */
 
 #include <cstdio>
@@ -32,30 +42,70 @@ Result files are created in the .\logs folder.
 #include <vector>
 #include <fstream>
 #include <climits>
+#include <cstring>
+#include <ctime>
 
 #include "BnBAllocator.h"
 #include "ILPAllocator.h"
+#include "LNSAllocator.h"
+#include "DecompositionAllocator.h"
+#include "PortfolioAllocator.h"
+#include "Tuner.h"
+#include "MemoryUsage.h"
 #include "AllocationProblem.h"
 #include "ProblemGenerator.h"
 #include "Timer.h"
 #include "AllocatorParams.h"
 #include "Utils.h"
 #include "ConfigParser.h"
+#include "InstanceFile.h"
+#include "LogSink.h"
+#include "ResultStore.h"
+#include "ConsolidationSession.h"
 
 using std::cout;
 using std::vector;
 using std::ofstream;
 using std::endl;
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc == 5 && std::string(argv[1]) == "convert")
+	{
+		return InstanceFile::convertFromText(argv[2], argv[3], std::stoi(argv[4])) ? 0 : 1;
+	}
+	if (argc == 4 && std::string(argv[1]) == "export")
+	{
+		ResultReader reader;
+		return (reader.read(argv[2]) && reader.exportCsv(argv[3])) ? 0 : 1;
+	}
+	if ((argc == 2 || argc == 3) && std::string(argv[1]) == "tune") // tune [budget in seconds]
+	{
+		ConfigParser parser("config.txt");
+		parser.parse();
+		Tuner tuner(parser, (argc == 3) ? std::stod(argv[2]) : 600);
+		if (!tuner.good())
+		{
+			cout << "Nothing to tune: the config file needs a BnB allocator and instances." << endl;
+			return 1;
+		}
+		#ifdef WIN32
+			ofstream report("logs\\Tuning_" + currentDateTime() + ".txt");
+		#else
+			ofstream report("logs/Tuning_" + currentDateTime() + ".txt");
+		#endif
+		tuner.run(report);
+		return 0;
+	}
+
 	std::string timeString = currentDateTime();
 	#ifdef WIN32
-		ofstream log("logs\\Log_" + timeString + ".txt");
+		LogSink logSink("logs\\Log_" + timeString + ".txt");
 	#else
-		ofstream log("logs/Log_" + timeString + ".txt");
+		LogSink logSink("logs/Log_" + timeString + ".txt");
 	#endif
-	if (!log.good())
+	LogStream log(logSink); // written by a background thread, does not slow down the measurements
+	if (!logSink.good())
 	{
 		cout << "Cannot create log files. Maybe the .\\logs folder doesn't exist?" << endl;
 		getchar();
@@ -69,6 +119,33 @@ int main()
 	std::unique_ptr<ProblemGenerator> generator = parser.getGenerator();
 	ParamsPtrVectorType paramsList = parser.getParamsList();
 
+	// initialize result store
+	std::string resultPath = parser.getResultFile();
+	if (resultPath.empty())
+	{
+		#ifdef WIN32
+			resultPath = "logs\\Results_" + timeString + ".bin";
+		#else
+			resultPath = "logs/Results_" + timeString + ".bin";
+		#endif
+	}
+	ResultWriter results(resultPath);
+	if (!results.good())
+	{
+		cout << "Cannot create result store " << resultPath << endl;
+		return 1;
+	}
+	unsigned int baseSeed = (parser.getSeed() >= 0) ? (unsigned int)parser.getSeed() : (unsigned int)time(NULL);
+
+	// the consolidation runs use the parameters of the first BnB configuration
+	int consolidationSteps = parser.getConsolidationSteps();
+	std::shared_ptr<AllocatorParams> consolidationParams;
+	for (unsigned i = 0; i < paramsList.size() && !consolidationParams; i++)
+	{
+		if (paramsList[i]->allocatorType == BnB)
+			consolidationParams = paramsList[i];
+	}
+
 	// initialize result file
 	#ifdef WIN32
 		ofstream output("logs\\Runtimes_" + timeString + ".csv");
@@ -96,7 +173,7 @@ int main()
 		output << paramsList[i]->name + ": cost";
 		output << "; ";
 
-		if (showDetailedCost && paramsList[i]->allocatorType == BnB)
+		if (showDetailedCost)
 		{
 			output << paramsList[i]->name + ": PMs on";
 			output << "; ";
@@ -110,6 +187,21 @@ int main()
 
 	ConfigParser::Steps vmSteps = parser.getVMs();
 	ConfigParser::Steps pmSteps = parser.getPMs();
+
+	// solving an instance from a file instead of generated ones
+	InstanceFile instanceFile;
+	ProblemInstancePtr fileInstance;
+	bool useInstanceFile = !parser.getInstanceFile().empty();
+	if (useInstanceFile)
+	{
+		if (!instanceFile.open(parser.getInstanceFile()) || !(fileInstance = instanceFile.toInstance()))
+		{
+			return 1;
+		}
+		vmSteps.from = vmSteps.to = instanceFile.getNumVMs();
+		pmSteps.from = pmSteps.to = instanceFile.getNumPMs();
+	}
+	int instanceId = 0; // running id of the instances in the log
 	int numVMs = vmSteps.from;
 	int numPMs = pmSteps.from;
 	while (numVMs <= vmSteps.to && numPMs <= pmSteps.to)
@@ -118,100 +210,103 @@ int main()
 		cout << "VMs: " << numVMs << " PMs: " << numPMs << ", Running " << parser.getNumTests() << " test(s) with " << paramsList.size() << " parameter setups each..." << endl;
 
 		generator->setNumVMsNumPMs(numVMs, numPMs); // finalizing generator
-		for (int i = 0; i < parser.getNumTests(); i++) // run for all instances
+		for (int i = 0; i < parser.getNumTests(); i++, instanceId++) // run for all instances
 		{
 			cout << "Instance " << i << ":" << endl;
 
-			AllocationProblem problem = generator->generate_ff();
-
-			// logging problem data
-			#ifdef VERBOSE_BASIC	
-				log << "Instance " << i << ":" << endl;
+			unsigned int seed = useInstanceFile ? 0 : baseSeed + instanceId; // each instance can be regenerated on its own
+			if (!useInstanceFile)
+			{
+				ProblemGenerator::setSeed(seed);
+			}
+			ProblemInstancePtr instance = useInstanceFile ? fileInstance : generator->generate_ff(); // shared by all allocators
 
-				int dimension = problem.VMs[0].demand.size();
-				log << std::endl << "PMs:\t";
-				for (auto pm : problem.PMs)
-				{
-					log << "[";
-					for (int i = 0; i < dimension; i++)
-					{
-						log << pm.capacity[i];
-						if (i != dimension - 1)
-							log << " ";
-					}
-
-					log << "] ";
-				}
-				log << std::endl << "VMs:\t";
-				for (auto vm : problem.VMs)
-				{
-					log << "[";
-					for (int i = 0; i < dimension; i++)
-					{
-						log << vm.demand[i];
-						if (i != dimension - 1)
-							log << " ";
-					}
-
-					log << "] ";
-				}
-				log << std::endl << "init:\t";
-				for (auto vm : problem.VMs)
-				{
-					log << vm.id << "->" << vm.initialID << " ";
-				}
-				log << std::endl << std::endl;
+			// logging problem data, the instance is dumped once and referred to by its id afterwards
+			#ifdef VERBOSE_BASIC
+				log.logInstance(instanceId, instance);
 			#endif
 
 			vector<double> solutions; // costs
 			vector<int> activeHosts;
 			vector<int> migrations;
 
-			// first allocator determines lower bound for the optimum
-			double initialLowerBound;
-			{
-				const std::string nameSaved(paramsList[0]->name);
-				paramsList[0]->name = "LB for optimum"; // using a dummy name instead of the real one
-				BnBAllocator dummyBnB(problem, paramsList[0], log);
-				initialLowerBound = dummyBnB.computeInitialLowerBound();
-				paramsList[0]->name = nameSaved;
-			}
+			// migration limit and cost model of the first allocator determine the lower bound for the optimum
+			double initialLowerBound = BnBAllocator::computeInitialLowerBound(*instance, CostModel(*instance, *paramsList[0]), numPMs / paramsList[0]->maxMigrationsRatio);
 
 			output << numVMs << " VMs, " << numPMs << " PMs";
 			output << "; ";
+			std::shared_ptr<VMAllocator> bestAllocator; // allocator with the best allocation so far on this instance, kept alive for warm starts
+			double bestCost = -1;
 			for (unsigned i = 0; i < paramsList.size(); i++) // run current instance for all configurations
 			{
 				cout << "\t" << paramsList[i]->name << "...";
 
 				#ifdef VERBOSE_BASIC	
-					log << "Parameter configuration: " << paramsList[i]->name << std::endl << std::endl;
+					log << "Parameter configuration: " << paramsList[i]->name << " on instance " << instanceId << std::endl << std::endl;
 				#endif
 
+				resetPeakResidentSetSize(); // the peak of this run, including the allocator's own data
 				t.start();
 				std::shared_ptr<VMAllocator> vmAllocator;
 				if (paramsList[i]->allocatorType == BnB)
 				{
-					vmAllocator = std::make_shared<BnBAllocator>(problem, paramsList[i], log);
+					vmAllocator = std::make_shared<BnBAllocator>(instance, paramsList[i], log);
 				}
 				else if (paramsList[i]->allocatorType == ILP)
 				{
-					vmAllocator = std::make_shared<ILPAllocator>(problem, paramsList[i], log);
+					vmAllocator = std::make_shared<ILPAllocator>(instance, paramsList[i], log);
+				}
+				else if (paramsList[i]->allocatorType == LNS)
+				{
+					vmAllocator = std::make_shared<LNSAllocator>(instance, paramsList[i], log);
+				}
+				else if (paramsList[i]->allocatorType == DECOMPOSITION)
+				{
+					vmAllocator = std::make_shared<DecompositionAllocator>(instance, paramsList[i], log);
+				}
+				else if (paramsList[i]->allocatorType == PORTFOLIO)
+				{
+					vmAllocator = std::make_shared<PortfolioAllocator>(instance, paramsList[i], log);
+				}
+				if (paramsList[i]->warmStart && bestAllocator)
+				{
+					vmAllocator->setIncumbent(bestAllocator->getBestAllocation());
 				}
 				vmAllocator->solve();
 				double elapsed = t.getElapsedTime();
+				long long peakMemory = peakResidentSetSize();
 				cout << " DONE!" << endl;
 				output << elapsed;
 				output << "; ";
 				double opt = vmAllocator->getBestCost();
 				solutions.push_back(opt);
-				if (showDetailedCost && paramsList[i]->allocatorType == BnB)
+				if (opt >= 0 && (bestCost < 0 || opt < bestCost) && !vmAllocator->getBestAllocation().empty())
 				{
-					std::shared_ptr<BnBAllocator> bnb = std::dynamic_pointer_cast<BnBAllocator>(vmAllocator);
-					activeHosts.push_back(bnb->getActiveHosts());
-					migrations.push_back(bnb->getMigrations());
+					bestAllocator = vmAllocator;
+					bestCost = opt;
 				}
+				activeHosts.push_back(vmAllocator->getActiveHosts());
+				migrations.push_back(vmAllocator->getMigrations());
+
+				ResultRecord record;
+				std::memset(&record, 0, sizeof(record));
+				record.instanceId = instanceId;
+				record.seed = seed;
+				record.numVMs = numVMs;
+				record.numPMs = numPMs;
+				std::strncpy(record.configName, paramsList[i]->name.c_str(), RESULT_CONFIG_NAME_LENGTH - 1);
+				record.runtime = elapsed;
+				record.cost = opt;
+				record.activeHosts = (opt >= 0) ? activeHosts.back() : -1;
+				record.migrations = (opt >= 0) ? migrations.back() : -1;
+				record.lowerBound = initialLowerBound;
+				record.nodes = vmAllocator->getNodeCount();
+				std::strncpy(record.winner, vmAllocator->getWinner().c_str(), RESULT_CONFIG_NAME_LENGTH - 1);
+				record.peakMemory = peakMemory;
+				results.append(record);
 				#ifdef VERBOSE_BASIC			
 					log << "Solution = " << opt << endl;
+					log << "Peak RSS = " << peakMemory << " kB" << endl;
 					log << "------------------" << endl;
 				#endif
 			}
@@ -224,7 +319,7 @@ int main()
 				output << solutions[i];
 				output << "; ";
 
-				if (showDetailedCost && paramsList[i]->allocatorType == BnB)
+				if (showDetailedCost)
 				{
 					output << activeHosts[i];
 					output << "; ";
@@ -235,8 +330,49 @@ int main()
 			}
 
 			output << endl;
+
+			// consolidation runs: random changes are applied to the best allocation one after the other
+			if (consolidationSteps > 0 && consolidationParams && bestAllocator)
+			{
+				vector<int> placement(numVMs, -1);
+				for (const auto& iter : bestAllocator->getBestAllocation())
+					placement[iter.first->id] = iter.second->id;
+				ConsolidationSession session(consolidationParams, log);
+				session.reset(instance, placement);
+				for (int step = 1; step <= consolidationSteps; step++)
+				{
+					cout << "\tConsolidation " << step << "...";
+					ConsolidationDelta delta = generator->generateDelta(*session.getInstance(), session.getVMIds(), session.getPMIds());
+					t.start();
+					double cost = session.apply(delta);
+					double elapsed = t.getElapsedTime();
+					cout << " DONE!" << endl;
+
+					ProblemInstancePtr current = session.getInstance();
+					ResultRecord record;
+					std::memset(&record, 0, sizeof(record));
+					record.instanceId = instanceId;
+					record.seed = seed;
+					record.numVMs = current->numVMs;
+					record.numPMs = current->numPMs;
+					std::snprintf(record.configName, RESULT_CONFIG_NAME_LENGTH, "Consolidation %d", step);
+					record.runtime = elapsed;
+					record.cost = cost;
+					record.activeHosts = (cost >= 0) ? session.getActiveHosts() : -1;
+					record.migrations = (cost >= 0) ? session.getMigrations() : -1;
+					record.lowerBound = -1;
+					record.nodes = -1;
+					std::strncpy(record.winner, consolidationParams->name.c_str(), RESULT_CONFIG_NAME_LENGTH - 1);
+					record.peakMemory = -1;
+					results.append(record);
+					#ifdef VERBOSE_BASIC
+						log << "Consolidation step " << step << ": " << current->numVMs << " VMs, " << current->numPMs << " PMs, cost = " << cost << ", runtime = " << elapsed << endl;
+					#endif
+				}
+			}
+			results.flush(); // rows of finished instances survive an aborted run
 			#ifdef VERBOSE_BASIC			
-				log << "===== End of instance =====" << endl;
+				log << "===== End of instance " << instanceId << " =====" << endl;
 			#endif
 		}
 
@@ -249,6 +385,5 @@ int main()
 	}
 
 	output.close();
-	log.close();
 	cout << "(Finished.)" << endl;
 }